@@ -0,0 +1,401 @@
+//
+// Created by vptyp on 19.10.26.
+//
+// Load generator for circular_buffer: producer/consumer threads over a locked buffer,
+// reports throughput and one-way latency percentiles.
+//
+
+#include "circular_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct options {
+    size_t producers = 1;
+    size_t consumers = 1;
+    size_t capacity = 1024;
+    size_t element_size = 16;
+    size_t ops = 1000000;
+    size_t burst = 1;
+    size_t pause_us = 0;
+    std::string lock = "mutex";
+    bool overwrite = false;
+    bool pin = false;
+    bool perf = false;
+};
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief element pushed through the buffer: timestamp of the push plus padding up to Size bytes.
+ */
+template <size_t Size>
+struct payload {
+    static_assert(Size >= sizeof(uint64_t), "payload must fit the timestamp");
+    uint64_t ts = 0;
+    char pad[Size - sizeof(uint64_t)] = {};
+};
+
+template <>
+struct payload<sizeof(uint64_t)> {
+    uint64_t ts = 0;
+};
+
+/**
+ * @brief log-linear latency histogram in the spirit of HdrHistogram.
+ * @details values below 2^SubBits are exact, above that every power of two is split
+ * into 2^(SubBits - 1) buckets, so the relative error stays below 1/2^(SubBits - 1).
+ */
+class histogram {
+    static constexpr unsigned SubBits = 8;
+    static constexpr uint64_t SubCount = 1ull << SubBits;
+    static constexpr uint64_t HalfCount = SubCount / 2;
+public:
+    histogram() : m_counts(SubCount + (64 - SubBits) * HalfCount, 0) {}
+
+    void record(uint64_t value) {
+        ++m_counts[index(value)];
+        ++m_total;
+        if(value > m_max) m_max = value;
+    }
+
+    void merge(const histogram& other) {
+        for(size_t i = 0; i < m_counts.size(); ++i)
+            m_counts[i] += other.m_counts[i];
+        m_total += other.m_total;
+        if(other.m_max > m_max) m_max = other.m_max;
+    }
+
+    /// upper bound of the bucket holding the given percentile
+    uint64_t percentile(double p) const {
+        if(m_total == 0) return 0;
+        auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(m_total));
+        if(rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for(size_t i = 0; i < m_counts.size(); ++i) {
+            seen += m_counts[i];
+            if(seen >= rank)
+                return std::min(upper(i), m_max);
+        }
+        return m_max;
+    }
+
+    uint64_t max() const { return m_max; }
+    uint64_t total() const { return m_total; }
+
+private:
+    static size_t index(uint64_t value) {
+        if(value < SubCount) return value;
+        unsigned msb = 63 - __builtin_clzll(value);
+        unsigned shift = msb - (SubBits - 1);
+        return SubCount + (shift - 1) * HalfCount + ((value >> shift) - HalfCount);
+    }
+
+    static uint64_t upper(size_t idx) {
+        if(idx < SubCount) return idx;
+        size_t shift = (idx - SubCount) / HalfCount + 1;
+        uint64_t sub = (idx - SubCount) % HalfCount + HalfCount;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> m_counts;
+    uint64_t m_total = 0;
+    uint64_t m_max = 0;
+};
+
+class spin_lock {
+public:
+    void lock() {
+        while(m_flag.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    void unlock() {
+        m_flag.clear(std::memory_order_release);
+    }
+private:
+    std::atomic_flag m_flag = ATOMIC_FLAG_INIT;
+};
+
+/**
+ * @brief circular_buffer guarded by a lock, the way the buffer is meant to be shared between threads.
+ */
+template <typename T, typename Lock>
+class locked_buffer {
+public:
+    explicit locked_buffer(size_t capacity) : m_buffer(capacity) {}
+
+    int push_back(const T& value) {
+        std::lock_guard<Lock> guard(m_lock);
+        return m_buffer.push_back(value);
+    }
+
+    int pop_front(T& value) {
+        std::lock_guard<Lock> guard(m_lock);
+        return m_buffer.pop_front(value);
+    }
+
+    void setSafe(bool safe) {
+        m_buffer.setSafe(safe);
+    }
+
+private:
+    Lock m_lock;
+    veryslot2::circular_buffer<T> m_buffer;
+};
+
+void pin_thread(size_t index) {
+#ifdef __linux__
+    auto cores = std::thread::hardware_concurrency();
+    if(cores == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)index;
+#endif
+}
+
+/**
+ * @brief process-wide hardware counters, inherited by the threads started after open().
+ */
+class perf_counters {
+public:
+    ~perf_counters() {
+#ifdef __linux__
+        for(int fd : m_fds)
+            if(fd >= 0) ::close(fd);
+#endif
+    }
+
+    bool open() {
+#ifdef __linux__
+        m_fds[0] = open_counter(PERF_COUNT_HW_CPU_CYCLES);
+        m_fds[1] = open_counter(PERF_COUNT_HW_CACHE_MISSES);
+        m_fds[2] = open_counter(PERF_COUNT_HW_INSTRUCTIONS);
+        return m_fds[0] >= 0;
+#else
+        return false;
+#endif
+    }
+
+    void report(std::ostream& out) const {
+#ifdef __linux__
+        const char* names[] = {"cycles", "cache misses", "instructions"};
+        for(size_t i = 0; i < 3; ++i) {
+            uint64_t value = 0;
+            if(m_fds[i] < 0 || ::read(m_fds[i], &value, sizeof(value)) != sizeof(value)) {
+                out << std::setw(14) << names[i] << ": n/a\n";
+                continue;
+            }
+            out << std::setw(14) << names[i] << ": " << value << "\n";
+        }
+#else
+        out << "perf counters are not supported on this platform\n";
+#endif
+    }
+
+private:
+#ifdef __linux__
+    static int open_counter(uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+    int m_fds[3] = {-1, -1, -1};
+};
+
+template <typename T, typename Lock>
+int run(const options& opt) {
+    locked_buffer<T, Lock> buffer(opt.capacity);
+    buffer.setSafe(!opt.overwrite);
+
+    perf_counters counters;
+    if(opt.perf && !counters.open())
+        std::cerr << "perf_event_open failed, counters disabled\n";
+
+    std::atomic<size_t> producers_left(opt.producers);
+    std::atomic<uint64_t> consumed(0);
+    std::atomic<bool> start(false);
+    std::vector<histogram> histograms(opt.consumers);
+    std::vector<std::thread> threads;
+
+    for(size_t p = 0; p < opt.producers; ++p) {
+        threads.emplace_back([&, p] {
+            if(opt.pin) pin_thread(p);
+            while(!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            T value;
+            size_t in_burst = 0;
+            for(size_t i = 0; i < opt.ops; ++i) {
+                value.ts = now_ns();
+                while(buffer.push_back(value) != 0)
+                    std::this_thread::yield();
+                if(opt.pause_us && ++in_burst == opt.burst) {
+                    in_burst = 0;
+                    std::this_thread::sleep_for(std::chrono::microseconds(opt.pause_us));
+                }
+            }
+            producers_left.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    for(size_t c = 0; c < opt.consumers; ++c) {
+        threads.emplace_back([&, c] {
+            if(opt.pin) pin_thread(opt.producers + c);
+            while(!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            T value;
+            uint64_t local = 0;
+            // recorded thread-locally, adjacent histograms in the vector would share cache lines
+            histogram latency;
+            for(;;) {
+                // checked before the pop: if the producers were done already, an empty buffer stays empty
+                bool done = producers_left.load(std::memory_order_acquire) == 0;
+                if(buffer.pop_front(value) == 0) {
+                    latency.record(now_ns() - value.ts);
+                    ++local;
+                    continue;
+                }
+                if(done)
+                    break;
+                std::this_thread::yield();
+            }
+            consumed.fetch_add(local);
+            histograms[c] = std::move(latency);
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for(auto& thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    histogram latency;
+    for(const auto& h : histograms)
+        latency.merge(h);
+
+    std::cout << "lock: " << opt.lock << ", producers: " << opt.producers
+              << ", consumers: " << opt.consumers << ", capacity: " << opt.capacity
+              << ", element: " << sizeof(T) << " B, burst: " << opt.burst
+              << ", pause: " << opt.pause_us << " us\n";
+    std::cout << "produced: " << opt.ops * opt.producers << ", consumed: " << consumed.load()
+              << ", time: " << std::fixed << std::setprecision(3) << seconds << " s\n";
+    std::cout << "throughput: " << std::setprecision(0)
+              << static_cast<double>(consumed.load()) / seconds << " ops/s\n";
+    std::cout << "latency ns  p50: " << latency.percentile(50)
+              << "  p99: " << latency.percentile(99)
+              << "  p99.9: " << latency.percentile(99.9)
+              << "  max: " << latency.max() << "\n";
+    if(opt.perf)
+        counters.report(std::cout);
+    return 0;
+}
+
+template <typename T>
+int run_locked(const options& opt) {
+    if(opt.lock == "mutex") return run<T, std::mutex>(opt);
+    if(opt.lock == "spin") return run<T, spin_lock>(opt);
+    std::cerr << "unknown lock: " << opt.lock << "\n";
+    return 1;
+}
+
+void usage(const char* name) {
+    std::cout << "usage: " << name << " [options]\n"
+              << "  --producers N    producer threads (default 1)\n"
+              << "  --consumers N    consumer threads (default 1)\n"
+              << "  --capacity N     buffer capacity in elements (default 1024)\n"
+              << "  --size N         element size in bytes: 8, 16, 64, 256 or 1024 (default 16)\n"
+              << "  --ops N          elements pushed by every producer (default 1000000)\n"
+              << "  --burst N        elements pushed between pauses (default 1)\n"
+              << "  --pause US       pause after every burst in microseconds (default 0)\n"
+              << "  --lock NAME      mutex or spin (default mutex)\n"
+              << "  --overwrite      let producers overwrite instead of waiting for free space\n"
+              << "  --pin            pin threads to cores round robin\n"
+              << "  --perf           report cycles / cache misses / instructions\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    options opt;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> size_t {
+            if(i + 1 >= argc) {
+                std::cerr << "missing value for " << arg << "\n";
+                std::exit(1);
+            }
+            try {
+                const std::string value = argv[++i];
+                if(value.find('-') != std::string::npos)
+                    throw std::invalid_argument(value);
+                return std::stoull(value);
+            } catch(const std::exception&) {
+                std::cerr << "invalid value for " << arg << ": " << argv[i] << "\n";
+                usage(argv[0]);
+                std::exit(1);
+            }
+        };
+        if(arg == "--producers") opt.producers = next();
+        else if(arg == "--consumers") opt.consumers = next();
+        else if(arg == "--capacity") opt.capacity = next();
+        else if(arg == "--size") opt.element_size = next();
+        else if(arg == "--ops") opt.ops = next();
+        else if(arg == "--burst") opt.burst = next();
+        else if(arg == "--pause") opt.pause_us = next();
+        else if(arg == "--lock" && i + 1 < argc) opt.lock = argv[++i];
+        else if(arg == "--overwrite") opt.overwrite = true;
+        else if(arg == "--pin") opt.pin = true;
+        else if(arg == "--perf") opt.perf = true;
+        else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if(opt.producers == 0 || opt.consumers == 0 || opt.capacity == 0 || opt.burst == 0) {
+        std::cerr << "producers, consumers, capacity and burst must be greater than 0\n";
+        return 1;
+    }
+
+    switch(opt.element_size) {
+        case 8: return run_locked<payload<8>>(opt);
+        case 16: return run_locked<payload<16>>(opt);
+        case 64: return run_locked<payload<64>>(opt);
+        case 256: return run_locked<payload<256>>(opt);
+        case 1024: return run_locked<payload<1024>>(opt);
+        default:
+            std::cerr << "unsupported element size: " << opt.element_size << "\n";
+            return 1;
+    }
+}
@@ -0,0 +1,171 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#ifndef CASCADING_BUFFER_H
+#define CASCADING_BUFFER_H
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "circular_buffer.h"
+
+namespace veryslot2 {
+
+/// How the samples of a finer tier are rolled up into one bucket of a coarser tier.
+enum class aggregate {
+    min,
+    max,
+    avg,
+    sum,
+    last
+};
+
+    /**
+     * @brief Multi-resolution round-robin history, in the spirit of RRDtool.
+     * @details Every tier is a fixed-capacity circular_buffer. Tier 0 keeps raw samples, every coarser tier
+     * keeps one bucket per step samples. When a finer tier completes a bucket, the coarser tier folds it into
+     * its running aggregate, so ingest is O(number of tiers) and nothing is rescanned.
+     * @details Buckets that are still being accumulated are not visible in the tiers.
+     * @details Is not thread-safe. If you want to use it in a multi-threaded environment, you should use a mutex.
+     * @details avg keeps the raw sum of the samples of a bucket and divides it only when the bucket is written,
+     * so integral T is truncated once, not once per tier. The sum of step samples must fit in T.
+     * @tparam T is an arithmetic-like type: copyable, comparable, with + and / for avg.
+     */
+template <typename T>
+class cascading_buffer {
+public:
+    typedef int func_result;
+
+    struct tier_config {
+        /// number of buckets kept in the tier
+        size_t capacity;
+        /// number of raw samples per bucket, 1 for the first tier
+        size_t step;
+    };
+
+    cascading_buffer() = delete;
+
+    /**
+     * @param tiers from the finest to the coarsest. The first step must be 1, every next step
+     * must be a multiple of the previous one. For a year of 1 s samples kept at 1 s / 1 min / 1 h:
+     * {{86400, 1}, {10080, 60}, {8784, 3600}}
+     */
+    cascading_buffer(const std::vector<tier_config>& tiers, aggregate function) :
+    m_function(function)
+    {
+        if(tiers.empty() || tiers.front().step != 1)
+            throw std::invalid_argument("The first tier must have step 1");
+        m_tiers.reserve(tiers.size());
+        for(size_t i = 0; i < tiers.size(); ++i) {
+            if(i && (tiers[i].step <= tiers[i - 1].step || tiers[i].step % tiers[i - 1].step))
+                throw std::invalid_argument("Every tier step must be a multiple of the previous one");
+            m_tiers.push_back(tier{circular_buffer<T>(tiers[i].capacity), tiers[i].step,
+                                   i ? tiers[i].step / tiers[i - 1].step : 1});
+        }
+    }
+
+    /**
+     * @brief add one raw sample and roll it up through the tiers.
+     * @details O(number of tiers), does not allocate unless the tiers are shared with a copy
+     * (see circular_buffer implicit sharing).
+     * @return 0 if done.
+     */
+    func_result push_back(const T& value) {
+        m_tiers.front().ring.push_back(value);
+        // aggregate of the bucket just completed; for avg the raw sum, divided only when written to a ring
+        T carry = value;
+        for(size_t i = 1; i < m_tiers.size(); ++i) {
+            tier& current = m_tiers[i];
+            current.accumulator = current.count ? combine(current.accumulator, carry) : carry;
+            if(++current.count < current.factor)
+                return 0;
+            carry = current.accumulator;
+            current.count = 0;
+            current.ring.push_back(m_function == aggregate::avg
+                                   ? carry / static_cast<T>(current.step)
+                                   : carry);
+        }
+        return 0;
+    }
+
+    [[nodiscard]] size_t tiers() const {
+        return m_tiers.size();
+    }
+
+    const circular_buffer<T>& tier_buffer(size_t index) const {
+        return m_tiers.at(index).ring;
+    }
+
+    [[nodiscard]] size_t step(size_t index) const {
+        return m_tiers.at(index).step;
+    }
+
+    [[nodiscard]] aggregate function() const {
+        return m_function;
+    }
+
+    /**
+     * @brief the finest tier able to hold the last samples raw samples in at most max_points buckets.
+     * @details the coarsest tier if none of them can.
+     */
+    [[nodiscard]] size_t tier_for(size_t samples, size_t max_points = std::numeric_limits<size_t>::max()) const {
+        for(size_t i = 0; i < m_tiers.size(); ++i) {
+            const tier& current = m_tiers[i];
+            size_t points = (samples + current.step - 1) / current.step;
+            if(points <= current.ring.capacity() && points <= max_points)
+                return i;
+        }
+        return m_tiers.size() - 1;
+    }
+
+    /**
+     * @brief buckets covering the last samples raw samples, from the oldest to the newest,
+     * taken from the tier chosen by tier_for.
+     */
+    std::vector<T> last(size_t samples, size_t max_points = std::numeric_limits<size_t>::max()) const {
+        const tier& current = m_tiers[tier_for(samples, max_points)];
+        size_t points = std::min((samples + current.step - 1) / current.step, current.ring.size());
+        std::vector<T> result;
+        result.reserve(points);
+        for(size_t i = current.ring.size() - points; i < current.ring.size(); ++i)
+            result.push_back(current.ring[i]);
+        return result;
+    }
+
+    void clear() {
+        for(auto& current : m_tiers) {
+            current.ring.clear();
+            current.count = 0;
+        }
+    }
+
+private:
+    struct tier {
+        circular_buffer<T> ring;
+        size_t step;
+        /// number of buckets of the previous tier per bucket of this one
+        size_t factor;
+        T accumulator = T();
+        size_t count = 0;
+    };
+
+    T combine(const T& accumulator, const T& value) const {
+        switch(m_function) {
+            case aggregate::min: return std::min(accumulator, value);
+            case aggregate::max: return std::max(accumulator, value);
+            case aggregate::avg:
+            case aggregate::sum: return accumulator + value;
+            case aggregate::last: return value;
+        }
+        return value;
+    }
+
+private:
+    std::vector<tier> m_tiers;
+    aggregate m_function;
+};
+
+}
+
+#endif //CASCADING_BUFFER_H
@@ -0,0 +1,170 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#ifndef CHUNKED_QUEUE_H
+#define CHUNKED_QUEUE_H
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <stdexcept>
+#include <type_traits>
+#include "circular_buffer.h"
+
+namespace veryslot2 {
+
+    /**
+     * @brief Unbounded FIFO queue built from a linked list of fixed-size circular_buffer chunks.
+     * @details When the last chunk is full a new one is attached, taken from the pool of drained chunks
+     * if there is one, so a burst never loses data and never copies the elements already queued,
+     * unlike circular_buffer::resize. Chunks that drained are moved back to the pool, the pool keeps
+     * at most max_pooled chunks and frees the rest.
+     * @details Chunks are moved between the queue and the pool with std::list::splice, which does not allocate.
+     * @details Is not thread-safe. If you want to use it in a multi-threaded environment, you should use a mutex.
+     * @tparam T is the type of the elements in the queue. Must be default-constructible.
+     */
+template <typename T>
+class chunked_queue {
+public:
+    typedef int func_result;
+
+    chunked_queue() = delete;
+
+    /**
+     * @param chunk_capacity number of elements in one chunk.
+     * @param max_pooled number of drained chunks kept for reuse.
+     */
+    explicit chunked_queue(const size_t chunk_capacity, const size_t max_pooled = 4) :
+    m_chunk_capacity(chunk_capacity), m_max_pooled(max_pooled)
+    {
+        if(m_chunk_capacity == 0)
+            throw std::invalid_argument("Capacity must be greater than 0");
+    }
+
+    /**
+     * @brief push to the back of the queue, attaching a new chunk if the last one is full.
+     * @details amortized O(1), allocates only if the pool is empty.
+     * @return 0 if done.
+     */
+    func_result push_back(const T& value) {
+        auto temp = value;
+        return push_back(std::move(temp));
+    }
+
+    func_result push_back(T&& value) {
+        if(m_chunks.empty() || m_chunks.back().push_back(std::move(value)) != 0) {
+            attach();
+            m_chunks.back().push_back(std::move(value));
+        }
+        ++m_size;
+        return 0;
+    }
+
+    template<class... Args>
+    func_result emplace_back(Args... args) {
+        return push_back(T(args...));
+    }
+
+    /**
+     * @brief append a range, filling the free space of every chunk with one bulk insert.
+     * @return 0, nothing is ever skipped.
+     */
+    template <typename InputIterator>
+    func_result insert_back(InputIterator begin, const InputIterator end) {
+        typedef typename std::iterator_traits<InputIterator>::iterator_category category;
+        if constexpr (std::is_base_of_v<std::random_access_iterator_tag, category>) {
+            while(begin < end) {
+                if(m_chunks.empty() || free_space() == 0)
+                    attach();
+                size_t len = std::min<size_t>(free_space(), end - begin);
+                m_chunks.back().insert_back(begin, begin + len);
+                begin += len;
+                m_size += len;
+            }
+        } else {
+            for(; begin != end; ++begin)
+                push_back(*begin);
+        }
+        return 0;
+    }
+
+    /**
+     * @brief pop the oldest element. A chunk that drained is returned to the pool.
+     * @return 0 if done, -1 if queue is empty.
+     */
+    func_result pop_front(T& value) noexcept {
+        if(empty()) return -1;
+        m_chunks.front().pop_front(value);
+        --m_size;
+        if(m_chunks.front().empty())
+            detach();
+        return 0;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_size;
+    }
+
+    [[nodiscard]] size_t chunk_capacity() const {
+        return m_chunk_capacity;
+    }
+
+    /// number of chunks currently holding elements
+    [[nodiscard]] size_t chunks() const {
+        return m_chunks.size();
+    }
+
+    /// number of drained chunks waiting for reuse
+    [[nodiscard]] size_t pooled() const {
+        return m_pool.size();
+    }
+
+    void clear() {
+        while(!m_chunks.empty())
+            detach();
+        m_size = 0;
+    }
+
+    /// free all the pooled chunks
+    void shrink_to_fit() {
+        m_pool.clear();
+    }
+
+private:
+    size_t free_space() const {
+        return m_chunk_capacity - m_chunks.back().size();
+    }
+
+    void attach() {
+        if(m_pool.empty()) {
+            m_chunks.emplace_back(m_chunk_capacity);
+            m_chunks.back().setSafe(true);
+            return;
+        }
+        m_chunks.splice(m_chunks.end(), m_pool, m_pool.begin());
+    }
+
+    void detach() noexcept {
+        if(m_pool.size() >= m_max_pooled) {
+            m_chunks.pop_front();
+            return;
+        }
+        m_chunks.front().clear();
+        m_pool.splice(m_pool.end(), m_chunks, m_chunks.begin());
+    }
+
+private:
+    std::list<circular_buffer<T>> m_chunks;
+    std::list<circular_buffer<T>> m_pool;
+    size_t m_chunk_capacity = 0;
+    size_t m_max_pooled = 0;
+    size_t m_size = 0;
+};
+
+}
+
+#endif //CHUNKED_QUEUE_H
@@ -6,7 +6,10 @@
 #define CIRCULARBUFFER_H
 #include <vector>
 #include <QVector>
+#include <algorithm>
 #include <iterator>
+#include <memory>
+#include <utility>
 
 namespace veryslot2 {
 
@@ -14,8 +17,9 @@ namespace veryslot2 {
 * @brief STL compliant iterator for circular buffer. Implements random access iterator.
 * @tparam ValueType type of the value in the circular buffer.
 * @tparam BufferType type of the circular buffer.
+* @tparam Reference type returned by dereference. Proxy references (e.g. a tuple of references) are allowed.
 */
-template <class BufferType, typename ValueType>
+template <class BufferType, typename ValueType, typename Reference = ValueType&>
 class circular_buffer_iterator {
     friend BufferType;
 private:
@@ -30,7 +34,7 @@ public:
     /// This type represents a pointer-to-value_type.
     typedef ValueType* pointer;
     /// This type represents a reference-to-value_type.
-    typedef ValueType& reference;
+    typedef Reference reference;
 
     circular_buffer_iterator(const circular_buffer_iterator& other)
             : m_ptr(other.m_ptr), m_position(other.m_position) {}
@@ -61,7 +65,7 @@ public:
         return !(*this < other);
     }
     circular_buffer_iterator& operator++() {
-        if(m_position < m_ptr->m_capacity)
+        if(m_position < m_ptr->capacity())
             m_position++;
         return *this;
     }
@@ -98,13 +102,13 @@ public:
     size_t operator-(const circular_buffer_iterator& other) const {
         return m_position - other.m_position;
     }
-    ValueType& operator*() const {
+    Reference operator*() const {
         return (*m_ptr)[m_position];
     }
     ValueType* operator->() const {
         return &operator*();
     }
-    ValueType& operator[](const size_t offset) const {
+    Reference operator[](const size_t offset) const {
         return (*m_ptr)[m_position + offset];
     }
 
@@ -121,6 +125,11 @@ private:
      * @details Can work only with default-constructible elements. Version 2.0 will support non-default-constructible elements.
      * @details Can be overwrite safe or not. If it is safe, the push_back operation will return -1 if the buffer is full.
      * Currently only for push_back. Version 2.0 will support insert_back.
+     * @details Implicitly shared, like QVector: copies share the storage until one of them writes to it,
+     * so a copy is O(1) and only the first write after a copy pays for the detach (deep copy).
+     * Non-const element access (operator[], at, iterator) counts as a write.
+     * As with QVector, a T& or T* taken from operator[], at() or linearize() before a copy is made
+     * still points into the shared storage, and writing through it changes the copy too.
      * @tparam T is the type of the elements in the buffer. Must be default-constructible.
      */
 template <typename T>
@@ -130,6 +139,9 @@ public:
     typedef circular_buffer_iterator<const circular_buffer, const T> const_iterator;
     typedef std::reverse_iterator<iterator> reverse_iterator;
     typedef int func_result;
+    /// Contiguous part of the buffer: pointer to the first element and number of elements.
+    typedef std::pair<T*, size_t> array_range;
+    typedef std::pair<const T*, size_t> const_array_range;
     friend iterator;
     friend const_iterator;
     friend reverse_iterator;
@@ -137,22 +149,12 @@ public:
     circular_buffer(iterator first, iterator last) = delete;
     circular_buffer(const_iterator first, const_iterator last) = delete;
     circular_buffer(circular_buffer&& other) noexcept {
-        delete[] m_buffer;
-        m_capacity = other.m_capacity;
-        m_buffer = other.m_buffer;
-        m_head = other.m_head;
-        m_tail = other.m_tail;
-        isFull = other.isFull;
-        other.m_buffer = nullptr;
-        other.m_capacity = 0;
-        other.m_head = 0;
-        other.m_tail = 0;
-        other.isFull = false;
+        *this = std::move(other);
     }
     circular_buffer& operator=(circular_buffer&& other) noexcept {
         if(this == &other) return *this;
-        delete[] m_buffer;
         m_capacity = other.m_capacity;
+        m_storage = std::move(other.m_storage);
         m_buffer = other.m_buffer;
         m_head = other.m_head;
         m_tail = other.m_tail;
@@ -164,23 +166,23 @@ public:
         other.isFull = false;
         return *this;
     }
+    /**
+     * @brief O(1), the storage is shared until one of the buffers writes to it.
+     */
     circular_buffer(const circular_buffer& other)
-    : m_capacity(other.m_capacity), m_head(other.m_head),
-    m_tail(other.m_tail), isFull(other.isFull), safe(other.safe)
+    : m_storage(other.m_storage), m_buffer(other.m_buffer), m_capacity(other.m_capacity),
+    m_head(other.m_head), m_tail(other.m_tail), safe(other.safe), isFull(other.isFull)
     {
-        m_buffer = new T[m_capacity];
-        std::copy(other.m_buffer, other.m_buffer + other.m_capacity,
-                  m_buffer);
     }
     circular_buffer& operator=(const circular_buffer& other) {
         if(this == &other) return *this;
+        m_storage = other.m_storage;
+        m_buffer = other.m_buffer;
         m_capacity = other.m_capacity;
-        m_buffer = new T[m_capacity];
         m_head = other.m_head;
         m_tail = other.m_tail;
+        safe = other.safe;
         isFull = other.isFull;
-        std::copy(other.m_buffer, other.m_buffer +
-        other.m_capacity, m_buffer);
         return *this;
     }
     //circular_buffer(const QVector<T>&);
@@ -189,25 +191,25 @@ public:
     {
         if(m_capacity == 0)
             throw std::invalid_argument("Capacity must be greater than 0");
-        m_buffer = new T[capacity]{T()};
+        m_storage.reset(new T[capacity]{T()});
+        m_buffer = m_storage.get();
     }
 
-    ~circular_buffer() {
-        delete[] m_buffer;
-    }
     /**
      * @brief implement the push-back operation to the circular buffer if the buffer is full,
      * the oldest element will be overwritten.
-     * @details this operation is O(1) and will not throw any exception.
+     * @details this operation is O(1). The first write after a copy detaches the storage, which is O(capacity)
+     * and throws if allocating or copying the elements throws.
      * @return 0 if done, -1 if buffer is full and safe mode is on.
      */
-    func_result push_back(const T& value) noexcept{
+    func_result push_back(const T& value) {
         auto temp = value;
         return push_back(std::move(temp));
     }
 
-    func_result push_back(T&& value) noexcept{
+    func_result push_back(T&& value) {
         if(safe && isFull) return -1;
+        detach();
         m_buffer[m_tail] = std::move(value);
         // buffer is full
         m_head = (m_head + isFull) % m_capacity;
@@ -217,7 +219,7 @@ public:
     }
 
     template <typename InputIterator>
-    func_result insert_back(const InputIterator begin, const InputIterator end) noexcept {
+    func_result insert_back(const InputIterator begin, const InputIterator end) {
         size_t skipped = 0;
         for(auto it = begin; it != end; ++it, ++skipped) {
             this->push_back(*it);
@@ -226,17 +228,21 @@ public:
     }
 
     func_result insert_back(const typename veryslot2::circular_buffer<T>::iterator begin,
-                            const typename veryslot2::circular_buffer<T>::iterator end) noexcept {
+                            const typename veryslot2::circular_buffer<T>::iterator end) {
         return private_insert_back(begin, end);
     }
 
     func_result insert_back(const typename QVector<T>::iterator begin,
-                                    const typename QVector<T>::iterator end) noexcept {
+                                    const typename QVector<T>::iterator end) {
         return private_insert_back(begin, end);
     }
 
     func_result insert_back(const typename std::vector<T>::iterator begin,
-                                const typename std::vector<T>::iterator end) noexcept {
+                                const typename std::vector<T>::iterator end) {
+        return private_insert_back(begin, end);
+    }
+
+    func_result insert_back(const T* begin, const T* end) {
         return private_insert_back(begin, end);
     }
 
@@ -269,12 +275,84 @@ public:
         return 0;
     }
 
-    T& operator[](size_t index) const{
+    /**
+     * @brief remove n oldest elements from the buffer without reading them.
+     * @details this operation is O(1). If n is greater than size, the buffer is cleared.
+     */
+    void erase_begin(size_t n) noexcept {
+        if(n >= size()) {
+            m_head = m_tail;
+            isFull = false;
+            return;
+        }
+        if(n == 0) return;
+        m_head = (m_head + n) % m_capacity;
+        isFull = false;
+    }
+
+    /**
+     * @brief first contiguous part of the buffer, starting at the oldest element.
+     * @details same as boost::circular_buffer::array_one. The non-const version detaches the storage.
+     */
+    array_range array_one() {
+        detach();
+        auto range = std::as_const(*this).array_one();
+        return {const_cast<T*>(range.first), range.second};
+    }
+
+    const_array_range array_one() const {
+        if(empty()) return {m_buffer + m_head, 0};
+        if(m_tail > m_head) return {m_buffer + m_head, m_tail - m_head};
+        return {m_buffer + m_head, m_capacity - m_head};
+    }
+
+    /**
+     * @brief second contiguous part of the buffer, empty if the data did not wrap around.
+     * @details same as boost::circular_buffer::array_two. The non-const version detaches the storage.
+     */
+    array_range array_two() {
+        detach();
+        auto range = std::as_const(*this).array_two();
+        return {const_cast<T*>(range.first), range.second};
+    }
+
+    const_array_range array_two() const {
+        if(empty() || m_tail > m_head) return {m_buffer, 0};
+        return {m_buffer, m_tail};
+    }
+
+    /**
+     * @brief rotate the storage so all the elements are contiguous.
+     * @details same as boost::circular_buffer::linearize. O(n) if the data wrapped around, O(1) otherwise.
+     * Iterators stay valid, because they are index based.
+     * @return pointer to the first element.
+     */
+    T* linearize() {
+        if(std::as_const(*this).array_two().second == 0)
+            return array_one().first;
+        detach();
+        size_t count = size();
+        std::rotate(m_buffer, m_buffer + m_head, m_buffer + m_capacity);
+        m_head = 0;
+        m_tail = count % m_capacity;
+        return m_buffer;
+    }
+
+    T& operator[](size_t index) {
+        detach();
+        return m_buffer[(m_head + index) % m_capacity];
+    }
+
+    const T& operator[](size_t index) const {
         return m_buffer[(m_head + index) % m_capacity];
     }
 
-    T* at(size_t index) const{
-        return &m_buffer[(m_head + index) % m_capacity];
+    T* at(size_t index) {
+        return &(*this)[index];
+    }
+
+    const T* at(size_t index) const {
+        return &(*this)[index];
     }
 
     /**
@@ -296,6 +374,14 @@ public:
         this->safe = safe;
     }
 
+    /**
+     * @brief same as QVector::isDetached.
+     * @return true if the storage is not shared with any other buffer.
+     */
+    bool isDetached() const {
+        return m_storage.use_count() <= 1;
+    }
+
     /**
     * @brief tail - head gives the number of elements in the buffer and
         if the tail is less than the head then the buffer has wrapped around.
@@ -338,15 +424,15 @@ public:
     }
 
     void resize(size_t new_capacity) {
-        T* new_buffer = new T[new_capacity]{T()};
+        std::shared_ptr<T[]> new_storage(new T[new_capacity]{T()});
         size_t new_size = std::min(new_capacity, size());
         int idx = new_capacity - size();
         idx = idx < 0 ? 0 - idx : 0;
         for (size_t i = 0; i < new_size; i++) {
-            new_buffer[i] = (*this)[idx + i];
+            new_storage[i] = std::as_const(*this)[idx + i];
         }
-        delete[] m_buffer;
-        m_buffer = new_buffer;
+        m_storage = std::move(new_storage);
+        m_buffer = m_storage.get();
         m_capacity = new_capacity;
         m_head = 0;
         m_tail = new_size % new_capacity;
@@ -359,9 +445,10 @@ public:
 private:
     template <typename RandomIterator>
     func_result private_insert_back(const RandomIterator begin,
-                                    const RandomIterator end) noexcept
+                                    const RandomIterator end)
     {
         if (begin >= end) return -1;
+        detach();
         if (std::distance(begin, end) >= m_capacity) {
             auto moved_begin = begin +
                     (std::distance(begin, end) - m_capacity);
@@ -386,20 +473,28 @@ private:
         return 0;
     }
 
+    /**
+     * @brief give this buffer its own copy of the storage if it is shared.
+     */
+    void detach() {
+        if(isDetached()) return;
+        std::shared_ptr<T[]> own(new T[m_capacity]);
+        std::copy(m_buffer, m_buffer + m_capacity, own.get());
+        m_storage = std::move(own);
+        m_buffer = m_storage.get();
+    }
+
+    /**
+     * @brief moves the head to the new tail if writing move elements overwrites the oldest ones.
+     * Must be called before the tail is updated.
+     */
     void tail_to_head(size_t to, size_t move) {
-        if(isFull){
+        if(move >= m_capacity - size())
             m_head = to;
-            return;
-        }
-
-        if(m_tail < m_head || (!m_tail && !m_head)){
-            m_head = m_tail + move > m_head ? to : m_head;
-            return;
-        }
-
-        m_head = to > m_head ? to : m_head;
     }
 private:
+    std::shared_ptr<T[]> m_storage;
+    /// m_storage.get(), cached
     T* m_buffer = nullptr;
     size_t m_capacity = 0;
     size_t m_head = 0;
@@ -0,0 +1,77 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#include "circular_buffer_device.h"
+#include <algorithm>
+#include <cstring>
+
+namespace veryslot2 {
+
+circular_buffer_device::circular_buffer_device(circular_buffer<char>* buffer, QObject* parent)
+        : QIODevice(parent), m_buffer(buffer) {}
+
+bool circular_buffer_device::open(OpenMode mode) {
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+bool circular_buffer_device::isSequential() const {
+    return true;
+}
+
+qint64 circular_buffer_device::bytesAvailable() const {
+    return static_cast<qint64>(m_buffer->size()) + QIODevice::bytesAvailable();
+}
+
+bool circular_buffer_device::canReadLine() const {
+    const auto& ring = *m_buffer;
+    auto one = ring.array_one();
+    auto two = ring.array_two();
+    return std::memchr(one.first, '\n', one.second) != nullptr
+        || std::memchr(two.first, '\n', two.second) != nullptr
+        || QIODevice::canReadLine();
+}
+
+circular_buffer<char>* circular_buffer_device::buffer() const {
+    return m_buffer;
+}
+
+qint64 circular_buffer_device::readData(char* data, qint64 maxSize) {
+    // reading does not write to the storage, so a shared buffer is not detached
+    const auto& ring = *m_buffer;
+    auto one = ring.array_one();
+    auto two = ring.array_two();
+    size_t left = static_cast<size_t>(maxSize);
+    size_t from_one = std::min(left, one.second);
+    std::memcpy(data, one.first, from_one);
+    size_t from_two = std::min(left - from_one, two.second);
+    std::memcpy(data + from_one, two.first, from_two);
+    m_buffer->erase_begin(from_one + from_two);
+    return static_cast<qint64>(from_one + from_two);
+}
+
+qint64 circular_buffer_device::writeData(const char* data, qint64 maxSize) {
+    size_t len = static_cast<size_t>(maxSize);
+    if(m_buffer->isSafe())
+        len = std::min(len, m_buffer->capacity() - m_buffer->size());
+    if(len == 0) return 0;
+
+    m_buffer->insert_back(data, data + len);
+    m_written += static_cast<qint64>(len);
+    if(!m_signalsPending && !signalsBlocked()) {
+        m_signalsPending = true;
+        QMetaObject::invokeMethod(this, [this] { emitSignals(); }, Qt::QueuedConnection);
+    }
+    return static_cast<qint64>(len);
+}
+
+void circular_buffer_device::emitSignals() {
+    // reset first: writes from the slots below schedule their own emission
+    qint64 written = m_written;
+    m_written = 0;
+    m_signalsPending = false;
+    emit bytesWritten(written);
+    emit readyRead();
+}
+
+}
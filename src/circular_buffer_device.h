@@ -0,0 +1,51 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#ifndef CIRCULAR_BUFFER_DEVICE_H
+#define CIRCULAR_BUFFER_DEVICE_H
+#include <QIODevice>
+#include "circular_buffer.h"
+
+namespace veryslot2 {
+
+    /**
+     * @brief Sequential QIODevice on top of circular_buffer<char>, similar to QBuffer for QByteArray.
+     * @details read and write copy directly between the buffer segments and the caller memory.
+     * The device is always opened unbuffered, so QIODevice does not keep its own copy of the data.
+     * @details Like QBuffer, bytesWritten and readyRead are not emitted from inside write(): the written bytes
+     * are counted and both signals are emitted once from a queued invocation, so a slot that writes back
+     * to the device never recurses into writeData. Needs a running event loop to deliver them.
+     * @details Writing to a safe buffer writes only as much as fits, otherwise the oldest bytes are overwritten.
+     * @details The buffer is not owned and must outlive the device. Is not thread-safe.
+     */
+class circular_buffer_device : public QIODevice {
+    Q_OBJECT
+public:
+    explicit circular_buffer_device(circular_buffer<char>* buffer, QObject* parent = nullptr);
+
+    bool open(OpenMode mode) override;
+    [[nodiscard]] bool isSequential() const override;
+    [[nodiscard]] qint64 bytesAvailable() const override;
+    [[nodiscard]] bool canReadLine() const override;
+
+    [[nodiscard]] circular_buffer<char>* buffer() const;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    void emitSignals();
+
+private:
+    circular_buffer<char>* m_buffer;
+    /// bytes written since the last bytesWritten
+    qint64 m_written = 0;
+    /// a queued emitSignals call is already scheduled
+    bool m_signalsPending = false;
+};
+
+}
+
+#endif //CIRCULAR_BUFFER_DEVICE_H
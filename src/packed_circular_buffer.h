@@ -0,0 +1,336 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#ifndef PACKED_CIRCULAR_BUFFER_H
+#define PACKED_CIRCULAR_BUFFER_H
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "circular_buffer.h"
+
+namespace veryslot2 {
+
+    /**
+     * @brief Circular buffer of Bits-wide values packed densely into 64-bit words.
+     * @details A value never straddles two words, so Bits must divide 64: 1, 2, 4, 8, 16 or 32.
+     * 3-bit codes are stored in 4 bits.
+     * @details Elements are accessed through a proxy reference, with the same circular_buffer_iterator
+     * as circular_buffer. Like std::vector<bool>, the proxy is not a real reference, so algorithms
+     * that take the address of an element do not work.
+     * @details count, insert_words and extract_words work a word at a time instead of an element at a time.
+     * @details Same overwrite / safe semantics as circular_buffer. Is not thread-safe.
+     * @tparam Bits width of one value in bits.
+     * @tparam T type the values are read and written as. Defaults to the narrowest type holding Bits bits:
+     * bool for 1, uint8_t up to 8, uint16_t for 16 and uint32_t for 32.
+     */
+template <unsigned Bits, typename T = std::conditional_t<Bits == 1, bool,
+                                      std::conditional_t<Bits <= 8, uint8_t,
+                                      std::conditional_t<Bits <= 16, uint16_t, uint32_t>>>>
+class packed_circular_buffer {
+    static_assert(Bits >= 1 && Bits <= 32 && 64 % Bits == 0, "Bits must divide 64");
+    static_assert(Bits == 1 || sizeof(T) * 8 >= Bits, "T is too narrow for Bits");
+public:
+    /// values per 64-bit word
+    static constexpr size_t per_word = 64 / Bits;
+    /// mask of one value
+    static constexpr uint64_t value_mask = (uint64_t(1) << Bits) - 1;
+
+    /**
+     * @brief proxy reference to one packed value.
+     */
+    class reference {
+        friend packed_circular_buffer;
+        reference(uint64_t* word, unsigned shift) : m_word(word), m_shift(shift) {}
+    public:
+        operator T() const {
+            return static_cast<T>((*m_word >> m_shift) & value_mask);
+        }
+        reference& operator=(const T value) {
+            *m_word = (*m_word & ~(value_mask << m_shift))
+                    | ((static_cast<uint64_t>(value) & value_mask) << m_shift);
+            return *this;
+        }
+        reference& operator=(const reference& other) {
+            return *this = static_cast<T>(other);
+        }
+        friend void swap(reference a, reference b) {
+            T temp = a;
+            a = static_cast<T>(b);
+            b = temp;
+        }
+    private:
+        uint64_t* m_word;
+        unsigned m_shift;
+    };
+
+    typedef T value_type;
+    typedef circular_buffer_iterator<packed_circular_buffer, T, reference> iterator;
+    typedef circular_buffer_iterator<const packed_circular_buffer, const T, T> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef int func_result;
+    friend iterator;
+    friend const_iterator;
+
+    packed_circular_buffer() = delete;
+
+    explicit packed_circular_buffer(const size_t capacity) :
+    m_words((capacity + per_word - 1) / per_word, 0), m_capacity(capacity)
+    {
+        if(m_capacity == 0)
+            throw std::invalid_argument("Capacity must be greater than 0");
+    }
+
+    /**
+     * @brief same as circular_buffer::push_back.
+     * @return 0 if done, -1 if buffer is full and safe mode is on.
+     */
+    func_result push_back(const T value) noexcept {
+        if(safe && isFull) return -1;
+        slot(m_tail) = value;
+        m_head = (m_head + isFull) % m_capacity;
+        m_tail = (m_tail + 1) % m_capacity;
+        isFull = m_tail == m_head;
+        return 0;
+    }
+
+    /**
+     * @brief push every value of the range.
+     * @return number of values that did not stay in the buffer: overwritten by the same call,
+     * or rejected in safe mode.
+     */
+    template <typename InputIterator>
+    func_result insert_back(InputIterator begin, const InputIterator end) noexcept {
+        size_t pushed = 0;
+        size_t rejected = 0;
+        for(; begin != end; ++begin, ++pushed)
+            rejected += push_back(*begin) != 0;
+        return safe ? rejected : (pushed > m_capacity ? pushed - m_capacity : 0);
+    }
+
+    /**
+     * @brief bulk append of count values already packed in the same layout, starting at value first of words.
+     * @details copies up to a word at a time. Semantics of the return value are the same as insert_back.
+     */
+    func_result insert_words(const uint64_t* words, size_t count, size_t first = 0) noexcept {
+        size_t dropped = 0;
+        if(safe) {
+            size_t free = m_capacity - size();
+            if(count > free) {
+                dropped = count - free;
+                count = free;
+            }
+        } else if(count > m_capacity) {
+            dropped = count - m_capacity;
+            first += dropped;
+            count = m_capacity;
+        }
+        if(count == 0) return dropped;
+
+        const bool overflow = count >= m_capacity - size();
+        const size_t run = std::min(count, m_capacity - m_tail);
+        copy_values(m_words.data(), m_tail, words, first, run);
+        copy_values(m_words.data(), 0, words, first + run, count - run);
+        m_tail = (m_tail + count) % m_capacity;
+        if(overflow) m_head = m_tail;
+        isFull = overflow;
+        return dropped;
+    }
+
+    /**
+     * @brief copy count values starting at logical index first into words, packed from value 0.
+     * @details words must hold at least (count + per_word - 1) / per_word words, bits past the last value
+     * are left untouched. Copies up to a word at a time.
+     */
+    void extract_words(size_t first, size_t count, uint64_t* words) const noexcept {
+        const size_t position = (m_head + first) % m_capacity;
+        const size_t run = std::min(count, m_capacity - position);
+        copy_values(words, 0, m_words.data(), position, run);
+        copy_values(words, run, m_words.data(), 0, count - run);
+    }
+
+    /**
+     * @brief number of values equal to value among n values starting at logical index first.
+     * @details word at a time, with popcount. For bits, count(true, ...) is the number of set bits.
+     */
+    [[nodiscard]] size_t count(const T value, size_t first, size_t n) const noexcept {
+        if(first >= size()) return 0;
+        n = std::min(n, size() - first);
+        const size_t position = (m_head + first) % m_capacity;
+        const size_t run = std::min(n, m_capacity - position);
+        return count_range(value, position, position + run) + count_range(value, 0, n - run);
+    }
+
+    [[nodiscard]] size_t count(const T value) const noexcept {
+        return count(value, 0, size());
+    }
+
+    /**
+     * @brief pop the oldest value.
+     * @return 0 if done, -1 if buffer is empty.
+     */
+    func_result pop_front(T& value) noexcept {
+        if(empty()) return -1;
+        value = (*this)[0];
+        m_head = (m_head + 1) % m_capacity;
+        isFull = false;
+        return 0;
+    }
+
+    /**
+     * @brief drop the n oldest values, O(1).
+     */
+    void erase_begin(size_t n) noexcept {
+        if(n >= size()) {
+            m_head = m_tail;
+            isFull = false;
+            return;
+        }
+        if(n == 0) return;
+        m_head = (m_head + n) % m_capacity;
+        isFull = false;
+    }
+
+    reference operator[](size_t index) {
+        return slot((m_head + index) % m_capacity);
+    }
+
+    T operator[](size_t index) const {
+        const size_t position = (m_head + index) % m_capacity;
+        return static_cast<T>((m_words[position / per_word] >> shift(position)) & value_mask);
+    }
+
+    [[nodiscard]] bool empty() const {
+        return m_head == m_tail && !isFull;
+    }
+
+    [[nodiscard]] size_t size() const {
+        if(isFull) return m_capacity;
+        if(m_tail >= m_head)
+            return m_tail - m_head;
+        return m_capacity - m_head + m_tail;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return m_capacity;
+    }
+
+    /// bytes taken by the packed storage
+    [[nodiscard]] size_t storage_bytes() const {
+        return m_words.size() * sizeof(uint64_t);
+    }
+
+    bool isSafe() const {
+        return safe;
+    }
+
+    void setSafe(bool safe) {
+        this->safe = safe;
+    }
+
+    void clear() {
+        m_head = m_tail = 0;
+        isFull = false;
+    }
+
+    iterator begin() {
+        return iterator(this, 0);
+    }
+
+    iterator end() {
+        return iterator(this, size());
+    }
+
+    const_iterator cbegin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator cend() const {
+        return const_iterator(this, size());
+    }
+
+    reverse_iterator rbegin() {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() {
+        return reverse_iterator(begin());
+    }
+
+private:
+    /// 1 in the lowest bit of every value
+    static constexpr uint64_t low_bits() {
+        uint64_t mask = 0;
+        for(size_t i = 0; i < per_word; ++i)
+            mask |= uint64_t(1) << (i * Bits);
+        return mask;
+    }
+
+    static unsigned shift(size_t position) {
+        return static_cast<unsigned>(position % per_word * Bits);
+    }
+
+    /// mask of the values [from, to) of one word
+    static uint64_t values_mask(size_t from, size_t to) {
+        uint64_t upper = to == per_word ? ~uint64_t(0) : (uint64_t(1) << (to * Bits)) - 1;
+        uint64_t lower = (uint64_t(1) << (from * Bits)) - 1;
+        return upper & ~lower;
+    }
+
+    /**
+     * @brief copy count values from position from of src to position to of dst, positions in values.
+     * Every step moves as many values as fit in the rest of both the current source and destination word.
+     */
+    static void copy_values(uint64_t* dst, size_t to, const uint64_t* src, size_t from, size_t count) {
+        while(count) {
+            size_t step = std::min({count, per_word - to % per_word, per_word - from % per_word});
+            uint64_t mask = values_mask(0, step);
+            uint64_t value = (src[from / per_word] >> shift(from)) & mask;
+            uint64_t& word = dst[to / per_word];
+            word = (word & ~(mask << shift(to))) | (value << shift(to));
+            to += step;
+            from += step;
+            count -= step;
+        }
+    }
+
+    /// number of values equal to value in the physical positions [from, to)
+    size_t count_range(const T value, size_t from, size_t to) const {
+        if(from >= to) return 0;
+        const uint64_t pattern = (static_cast<uint64_t>(value) & value_mask) * low_bits();
+        size_t result = 0;
+        const size_t last = (to - 1) / per_word;
+        for(size_t w = from / per_word; w <= last; ++w) {
+            size_t lo = w == from / per_word ? from % per_word : 0;
+            size_t hi = w == last ? (to - 1) % per_word + 1 : per_word;
+            uint64_t lanes = low_bits() & values_mask(lo, hi);
+            // fold every value into its lowest bit: set if the value differs from the pattern
+            uint64_t diff = m_words[w] ^ pattern;
+            for(unsigned s = 1; s < Bits; s <<= 1)
+                diff |= diff >> s;
+            result += __builtin_popcountll(lanes) - __builtin_popcountll(diff & lanes);
+        }
+        return result;
+    }
+
+    reference slot(size_t position) {
+        return reference(&m_words[position / per_word], shift(position));
+    }
+
+private:
+    std::vector<uint64_t> m_words;
+    size_t m_capacity = 0;
+    size_t m_head = 0;
+    size_t m_tail = 0;
+    bool safe = false;
+    bool isFull = false;
+};
+
+/// one bit per element, e.g. per-tick flags
+typedef packed_circular_buffer<1> bit_circular_buffer;
+
+}
+
+#endif //PACKED_CIRCULAR_BUFFER_H
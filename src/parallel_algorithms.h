@@ -0,0 +1,217 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#ifndef PARALLEL_ALGORITHMS_H
+#define PARALLEL_ALGORITHMS_H
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "circular_buffer.h"
+
+namespace veryslot2 {
+
+    /**
+     * @brief Multi-threaded algorithms over circular_buffer.
+     * @details The buffer is split into contiguous chunks over its two physical segments (array_one / array_two),
+     * so every thread works on plain pointers instead of modulo-indexed iterators.
+     * @details threads = 0 means std::thread::hardware_concurrency(). Small buffers are processed
+     * with fewer threads, down to the calling thread only. An exception thrown by a callback
+     * is rethrown on the calling thread after all the chunks are done.
+     */
+namespace parallel {
+
+namespace detail {
+
+/// elements per thread below which spawning another thread does not pay off
+constexpr size_t min_chunk = 1 << 14;
+
+template <typename T>
+struct chunk {
+    T* first;
+    size_t size;
+    /// logical index of the first element of the chunk in the buffer
+    size_t offset;
+};
+
+inline size_t thread_count(size_t elements, size_t threads) {
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(threads, elements / min_chunk));
+}
+
+/**
+ * @brief chunks of a non-const buffer are writable and detach its storage, chunks of a const one are read-only.
+ */
+template <typename Buffer>
+auto split(Buffer& buffer, size_t threads) {
+    auto one = buffer.array_one();
+    auto two = buffer.array_two();
+    size_t count = one.second + two.second;
+    std::vector<chunk<std::remove_pointer_t<decltype(one.first)>>> chunks;
+    if(count == 0) return chunks;
+
+    size_t step = (count + thread_count(count, threads) - 1) / thread_count(count, threads);
+    for(size_t begin = 0; begin < count; begin += step) {
+        size_t end = std::min(count, begin + step);
+        if(begin < one.second) {
+            size_t last = std::min(end, one.second);
+            chunks.push_back({one.first + begin, last - begin, begin});
+        }
+        if(end > one.second) {
+            size_t first = std::max(begin, one.second);
+            chunks.push_back({two.first + (first - one.second), end - first, first});
+        }
+    }
+    return chunks;
+}
+
+/**
+ * @brief call function(index, task) for every task, the first one on the calling thread.
+ */
+template <typename Task, typename Function>
+void run(const std::vector<Task>& tasks, Function function) {
+    std::vector<std::exception_ptr> errors(tasks.size());
+    auto guarded = [&](size_t i) {
+        try {
+            function(i, tasks[i]);
+        } catch(...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(tasks.size());
+    for(size_t i = 1; i < tasks.size(); ++i)
+        threads.emplace_back(guarded, i);
+    if(!tasks.empty())
+        guarded(0);
+    for(auto& thread : threads)
+        thread.join();
+    for(auto& error : errors)
+        if(error) std::rethrow_exception(error);
+}
+
+}
+
+template <typename T, typename UnaryFunction>
+void for_each(circular_buffer<T>& buffer, UnaryFunction function, size_t threads = 0) {
+    detail::run(detail::split(buffer, threads), [&](size_t, const detail::chunk<T>& c) {
+        std::for_each(c.first, c.first + c.size, function);
+    });
+}
+
+/**
+ * @brief in-place transform: every element is replaced with operation(element).
+ */
+template <typename T, typename UnaryOperation>
+void transform(circular_buffer<T>& buffer, UnaryOperation operation, size_t threads = 0) {
+    detail::run(detail::split(buffer, threads), [&](size_t, const detail::chunk<T>& c) {
+        std::transform(c.first, c.first + c.size, c.first, operation);
+    });
+}
+
+/**
+ * @brief transform into a random access output range of at least buffer.size() elements.
+ * @return iterator past the last written element.
+ */
+template <typename T, typename RandomIterator, typename UnaryOperation,
+          typename = typename std::iterator_traits<RandomIterator>::iterator_category>
+RandomIterator transform(const circular_buffer<T>& buffer, RandomIterator out,
+                         UnaryOperation operation, size_t threads = 0) {
+    detail::run(detail::split(buffer, threads), [&](size_t, const detail::chunk<const T>& c) {
+        std::transform(c.first, c.first + c.size, out + c.offset, operation);
+    });
+    return out + buffer.size();
+}
+
+/**
+ * @brief parallel reduction. The operation must be associative, chunks are combined
+ * in logical order, so it does not have to be commutative.
+ */
+template <typename T, typename BinaryOperation = std::plus<T>>
+T reduce(const circular_buffer<T>& buffer, T init, BinaryOperation operation = BinaryOperation(),
+         size_t threads = 0) {
+    auto chunks = detail::split(buffer, threads);
+    std::vector<T> partial(chunks.size());
+    detail::run(chunks, [&](size_t i, const detail::chunk<const T>& c) {
+        partial[i] = std::accumulate(c.first + 1, c.first + c.size, *c.first, operation);
+    });
+    for(auto& value : partial)
+        init = operation(std::move(init), value);
+    return init;
+}
+
+/**
+ * @brief first element satisfying the predicate, in logical order.
+ * @return iterator to the element, buffer.end() if there is none.
+ */
+template <typename T, typename UnaryPredicate>
+typename circular_buffer<T>::iterator find_if(circular_buffer<T>& buffer, UnaryPredicate predicate,
+                                              size_t threads = 0) {
+    const size_t count = buffer.size();
+    std::atomic<size_t> found(count);
+    const auto& view = buffer;
+    detail::run(detail::split(view, threads), [&](size_t, const detail::chunk<const T>& c) {
+        // a match in an earlier chunk wins anyway
+        if(found.load(std::memory_order_relaxed) < c.offset) return;
+        auto it = std::find_if(c.first, c.first + c.size, predicate);
+        if(it == c.first + c.size) return;
+        size_t index = c.offset + (it - c.first);
+        size_t current = found.load(std::memory_order_relaxed);
+        while(index < current && !found.compare_exchange_weak(current, index)) {}
+    });
+    return buffer.begin() + found.load();
+}
+
+template <typename T>
+typename circular_buffer<T>::iterator find(circular_buffer<T>& buffer, const T& value, size_t threads = 0) {
+    return find_if(buffer, [&value](const T& element) { return element == value; }, threads);
+}
+
+/**
+ * @brief parallel sort: the buffer is linearized, equal parts are sorted on separate threads
+ * and then merged pairwise, also in parallel. Not stable.
+ */
+template <typename T, typename Compare = std::less<T>>
+void sort(circular_buffer<T>& buffer, Compare compare = Compare(), size_t threads = 0) {
+    const size_t count = buffer.size();
+    if(count < 2) return;
+    T* data = buffer.linearize();
+
+    const size_t parts = detail::thread_count(count, threads);
+    std::vector<size_t> bounds;
+    for(size_t i = 0; i <= parts; ++i)
+        bounds.push_back(count * i / parts);
+
+    std::vector<size_t> sorts(parts);
+    std::iota(sorts.begin(), sorts.end(), 0);
+    detail::run(sorts, [&](size_t, size_t part) {
+        std::sort(data + bounds[part], data + bounds[part + 1], compare);
+    });
+
+    while(bounds.size() > 2) {
+        std::vector<size_t> merges;
+        for(size_t i = 0; i + 2 < bounds.size(); i += 2)
+            merges.push_back(i);
+        detail::run(merges, [&](size_t, size_t i) {
+            std::inplace_merge(data + bounds[i], data + bounds[i + 1], data + bounds[i + 2], compare);
+        });
+        std::vector<size_t> merged;
+        for(size_t i = 0; i < bounds.size(); i += 2)
+            merged.push_back(bounds[i]);
+        if(merged.back() != count)
+            merged.push_back(count);
+        bounds.swap(merged);
+    }
+}
+
+}
+
+}
+
+#endif //PARALLEL_ALGORITHMS_H
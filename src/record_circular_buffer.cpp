@@ -0,0 +1,190 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#include "record_circular_buffer.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace veryslot2 {
+
+record_circular_buffer::const_iterator::const_iterator(const record_circular_buffer* ptr,
+                                                       size_t offset, size_t left)
+        : m_ptr(ptr), m_offset(left ? ptr->resolve(offset) : offset), m_left(left) {}
+
+bool record_circular_buffer::const_iterator::operator==(const const_iterator& other) const {
+    return m_ptr == other.m_ptr && m_left == other.m_left;
+}
+
+bool record_circular_buffer::const_iterator::operator!=(const const_iterator& other) const {
+    return !(*this == other);
+}
+
+record_circular_buffer::const_iterator& record_circular_buffer::const_iterator::operator++() {
+    if(m_left == 0) return *this;
+    m_offset = (m_offset + stride(m_ptr->header(m_offset)->size)) % m_ptr->m_capacity;
+    if(--m_left)
+        m_offset = m_ptr->resolve(m_offset);
+    return *this;
+}
+
+record_circular_buffer::const_iterator record_circular_buffer::const_iterator::operator++(int) {
+    const_iterator tmp(*this);
+    operator++();
+    return tmp;
+}
+
+record_circular_buffer::const_array_range record_circular_buffer::const_iterator::operator*() const {
+    return {m_ptr->m_buffer + m_offset + sizeof(record_header), m_ptr->header(m_offset)->size};
+}
+
+record_circular_buffer::record_circular_buffer(size_t capacity)
+        : m_capacity((capacity + alignment - 1) / alignment * alignment) {
+    if(m_capacity == 0)
+        throw std::invalid_argument("Capacity must be greater than 0");
+    m_buffer = new char[m_capacity];
+}
+
+record_circular_buffer::record_circular_buffer(record_circular_buffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+record_circular_buffer& record_circular_buffer::operator=(record_circular_buffer&& other) noexcept {
+    if(this == &other) return *this;
+    delete[] m_buffer;
+    m_buffer = other.m_buffer;
+    m_capacity = other.m_capacity;
+    m_head = other.m_head;
+    m_tail = other.m_tail;
+    m_used = other.m_used;
+    m_count = other.m_count;
+    safe = other.safe;
+    other.m_buffer = nullptr;
+    other.m_capacity = 0;
+    other.clear();
+    return *this;
+}
+
+record_circular_buffer::~record_circular_buffer() {
+    delete[] m_buffer;
+}
+
+record_circular_buffer::array_range record_circular_buffer::try_emplace(size_t size) noexcept {
+    if(size > max_record_size()) return {nullptr, 0};
+    const size_t need = stride(size);
+
+    for(;;) {
+        if(empty())
+            clear();
+
+        if(m_count == 0 || m_tail > m_head) {
+            // free space is [tail, capacity) and [0, head)
+            if(need <= m_capacity - m_tail)
+                break;
+            if(need <= m_head) {
+                header(m_tail)->size = wrap_marker;
+                m_used += m_capacity - m_tail;
+                m_tail = 0;
+                break;
+            }
+        } else if(need <= m_head - m_tail) {
+            // free space is [tail, head), empty if the arena is full
+            break;
+        }
+
+        if(safe) return {nullptr, 0};
+        pop_front();
+    }
+
+    record_header* h = header(m_tail);
+    h->size = static_cast<uint32_t>(size);
+    h->reserved = 0;
+    m_tail = (m_tail + need) % m_capacity;
+    m_used += need;
+    ++m_count;
+    return {reinterpret_cast<char*>(h) + sizeof(record_header), size};
+}
+
+record_circular_buffer::func_result record_circular_buffer::push_back(const void* data, size_t size) noexcept {
+    auto record = try_emplace(size);
+    if(record.first == nullptr) return -1;
+    // data may be null for an empty record, and memcpy from null is undefined even for 0 bytes
+    if(size)
+        std::memcpy(record.first, data, size);
+    return 0;
+}
+
+record_circular_buffer::const_array_range record_circular_buffer::front() const noexcept {
+    if(empty()) return {nullptr, 0};
+    return *begin();
+}
+
+record_circular_buffer::func_result record_circular_buffer::pop_front() noexcept {
+    if(empty()) return -1;
+    size_t len = stride(header(m_head)->size);
+    m_head = (m_head + len) % m_capacity;
+    m_used -= len;
+    // the head never rests on a wrap marker, so the gap is released together with the record before it
+    if(--m_count && resolve(m_head) != m_head) {
+        m_used -= m_capacity - m_head;
+        m_head = 0;
+    }
+    return 0;
+}
+
+size_t record_circular_buffer::max_record_size() const {
+    size_t limit = m_capacity - sizeof(record_header);
+    return limit < wrap_marker ? limit : wrap_marker - 1;
+}
+
+size_t record_circular_buffer::size() const {
+    return m_count;
+}
+
+size_t record_circular_buffer::bytes_used() const {
+    return m_used;
+}
+
+size_t record_circular_buffer::capacity() const {
+    return m_capacity;
+}
+
+bool record_circular_buffer::empty() const {
+    return m_count == 0;
+}
+
+void record_circular_buffer::clear() {
+    m_head = m_tail = 0;
+    m_used = 0;
+    m_count = 0;
+}
+
+bool record_circular_buffer::isSafe() const {
+    return safe;
+}
+
+void record_circular_buffer::setSafe(bool safe) {
+    this->safe = safe;
+}
+
+record_circular_buffer::const_iterator record_circular_buffer::begin() const {
+    return const_iterator(this, m_head, m_count);
+}
+
+record_circular_buffer::const_iterator record_circular_buffer::end() const {
+    return const_iterator(this, m_tail, 0);
+}
+
+size_t record_circular_buffer::stride(size_t size) {
+    return (sizeof(record_header) + size + alignment - 1) / alignment * alignment;
+}
+
+record_circular_buffer::record_header* record_circular_buffer::header(size_t offset) const {
+    return reinterpret_cast<record_header*>(m_buffer + offset);
+}
+
+size_t record_circular_buffer::resolve(size_t offset) const {
+    return header(offset)->size == wrap_marker ? 0 : offset;
+}
+
+}
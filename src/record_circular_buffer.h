@@ -0,0 +1,133 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#ifndef RECORD_CIRCULAR_BUFFER_H
+#define RECORD_CIRCULAR_BUFFER_H
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+namespace veryslot2 {
+
+    /**
+     * @brief Circular buffer of variable-length records packed back to back into one byte arena.
+     * @details Every record is an 8-byte header with its length followed by the payload, padded to 8 bytes,
+     * so payloads are 8-byte aligned. A record is never split: if it does not fit before the end of the arena,
+     * a wrap marker is written and the record goes to the beginning.
+     * @details Space is reclaimed by bytes: if a new record does not fit, the oldest records are evicted
+     * until it does. In safe mode nothing is evicted and try_emplace fails instead.
+     * @details Is not thread-safe. If you want to use it in a multi-threaded environment, you should use a mutex.
+     */
+class record_circular_buffer {
+public:
+    typedef int func_result;
+    /// Contiguous record payload: pointer to the first byte and length in bytes.
+    typedef std::pair<char*, size_t> array_range;
+    typedef std::pair<const char*, size_t> const_array_range;
+    static constexpr size_t alignment = 8;
+
+    /**
+     * @brief forward iterator over the records, from the oldest to the newest.
+     */
+    class const_iterator {
+        friend record_circular_buffer;
+        const_iterator(const record_circular_buffer* ptr, size_t offset, size_t left);
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef const_array_range value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const const_array_range* pointer;
+        typedef const_array_range reference;
+
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        const_array_range operator*() const;
+
+    private:
+        const record_circular_buffer* m_ptr;
+        size_t m_offset;
+        size_t m_left;
+    };
+
+    record_circular_buffer() = delete;
+    /**
+     * @param capacity size of the arena in bytes, rounded up to the alignment.
+     */
+    explicit record_circular_buffer(size_t capacity);
+    record_circular_buffer(const record_circular_buffer& other) = delete;
+    record_circular_buffer& operator=(const record_circular_buffer& other) = delete;
+    record_circular_buffer(record_circular_buffer&& other) noexcept;
+    record_circular_buffer& operator=(record_circular_buffer&& other) noexcept;
+    ~record_circular_buffer();
+
+    /**
+     * @brief reserve a record of the given size at the back of the buffer, evicting the oldest
+     * records if needed.
+     * @details The returned span stays valid until the next modification of the buffer.
+     * @return writable span of the record payload, {nullptr, 0} if the record can never fit
+     * or the buffer is in safe mode and there is not enough free space.
+     */
+    array_range try_emplace(size_t size) noexcept;
+
+    /**
+     * @brief copy a record to the back of the buffer.
+     * @return 0 if done, -1 if the record was not stored (see try_emplace).
+     */
+    func_result push_back(const void* data, size_t size) noexcept;
+
+    /**
+     * @brief the oldest record, read in place. {nullptr, 0} if the buffer is empty.
+     */
+    [[nodiscard]] const_array_range front() const noexcept;
+
+    /**
+     * @brief drop the oldest record.
+     * @return 0 if done, -1 if buffer is empty.
+     */
+    func_result pop_front() noexcept;
+
+    /// largest payload that can ever be stored
+    [[nodiscard]] size_t max_record_size() const;
+    /// number of records in the buffer
+    [[nodiscard]] size_t size() const;
+    /// bytes taken by records, their headers, padding and wrap gaps
+    [[nodiscard]] size_t bytes_used() const;
+    [[nodiscard]] size_t capacity() const;
+    [[nodiscard]] bool empty() const;
+    void clear();
+
+    [[nodiscard]] bool isSafe() const;
+    void setSafe(bool safe);
+
+    [[nodiscard]] const_iterator begin() const;
+    [[nodiscard]] const_iterator end() const;
+
+private:
+    struct record_header {
+        uint32_t size;
+        uint32_t reserved;
+    };
+    static constexpr uint32_t wrap_marker = UINT32_MAX;
+
+    static size_t stride(size_t size);
+    record_header* header(size_t offset) const;
+    /// offset of the record at offset, following a wrap marker if there is one
+    size_t resolve(size_t offset) const;
+
+private:
+    char* m_buffer = nullptr;
+    size_t m_capacity = 0;
+    size_t m_head = 0;
+    size_t m_tail = 0;
+    size_t m_used = 0;
+    size_t m_count = 0;
+    bool safe = false;
+};
+
+}
+
+#endif //RECORD_CIRCULAR_BUFFER_H
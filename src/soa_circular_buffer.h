@@ -0,0 +1,265 @@
+//
+// Created by vptyp on 19.10.26.
+//
+
+#ifndef SOA_CIRCULAR_BUFFER_H
+#define SOA_CIRCULAR_BUFFER_H
+#include <tuple>
+#include <utility>
+#include <stdexcept>
+#include "circular_buffer.h"
+
+namespace veryslot2 {
+
+    /**
+     * @brief Structure-of-arrays circular buffer. Every field of the record is stored in its own column array,
+     * all columns share the same head and tail.
+     * @details Scans over a single column touch only that column, and the column is exposed as at most
+     * two contiguous segments (array_one / array_two), so reductions over them can be vectorised.
+     * @details Row access goes through circular_buffer_iterator with a tuple-of-references proxy,
+     * column access goes through a plain circular_buffer_iterator over the column.
+     * @details Is not thread-safe. Same overwrite / safe semantics as circular_buffer.
+     * @tparam Fields types of the record fields. Must be default-constructible.
+     */
+template <typename... Fields>
+class soa_circular_buffer {
+public:
+    typedef std::tuple<Fields...> value_type;
+    typedef std::tuple<Fields&...> reference;
+    typedef circular_buffer_iterator<soa_circular_buffer, value_type, reference> iterator;
+    typedef int func_result;
+    /// Contiguous part of a column: pointer to the first element and number of elements.
+    template <typename T>
+    using array_range = std::pair<T*, size_t>;
+
+    /**
+     * @brief view over one column of the buffer. Indexing is relative to the head of the buffer.
+     * @details The view lives inside the buffer, so iterators of one column compare equal to each other.
+     */
+    template <typename T>
+    class column_view {
+        friend soa_circular_buffer;
+    public:
+        typedef T value_type;
+        typedef circular_buffer_iterator<const column_view, T> iterator;
+
+        T& operator[](size_t index) const {
+            return m_buffer[(m_owner->m_head + index) % m_owner->m_capacity];
+        }
+
+        [[nodiscard]] size_t size() const {
+            return m_owner->size();
+        }
+
+        [[nodiscard]] size_t capacity() const {
+            return m_owner->m_capacity;
+        }
+
+        iterator begin() const {
+            return iterator(this, 0);
+        }
+
+        iterator end() const {
+            return iterator(this, size());
+        }
+
+    private:
+        T* m_buffer = nullptr;
+        const soa_circular_buffer* m_owner = nullptr;
+    };
+
+    soa_circular_buffer() = delete;
+
+    explicit soa_circular_buffer(const size_t capacity) :
+    m_capacity(capacity)
+    {
+        if(m_capacity == 0)
+            throw std::invalid_argument("Capacity must be greater than 0");
+        std::apply([capacity](auto&... column) {
+            ((column.m_buffer = new typename std::decay_t<decltype(column)>::value_type[capacity]{}), ...);
+        }, m_columns);
+        bind_columns();
+    }
+
+    soa_circular_buffer(const soa_circular_buffer& other) :
+    m_capacity(other.m_capacity), m_head(other.m_head),
+    m_tail(other.m_tail), safe(other.safe), isFull(other.isFull)
+    {
+        copy_columns(other, std::index_sequence_for<Fields...>{});
+        bind_columns();
+    }
+
+    soa_circular_buffer(soa_circular_buffer&& other) noexcept {
+        steal(other);
+    }
+
+    soa_circular_buffer& operator=(const soa_circular_buffer& other) {
+        if(this == &other) return *this;
+        soa_circular_buffer temp(other);
+        return *this = std::move(temp);
+    }
+
+    soa_circular_buffer& operator=(soa_circular_buffer&& other) noexcept {
+        if(this == &other) return *this;
+        release();
+        steal(other);
+        return *this;
+    }
+
+    ~soa_circular_buffer() {
+        release();
+    }
+
+    /**
+     * @brief push one record to the back of the buffer. If the buffer is full,
+     * the oldest record will be overwritten.
+     * @details this operation is O(1) and will not throw any exception.
+     * @return 0 if done, -1 if buffer is full and safe mode is on.
+     */
+    func_result push_back(const Fields&... values) noexcept {
+        if(safe && isFull) return -1;
+        assign(m_tail, std::forward_as_tuple(values...), std::index_sequence_for<Fields...>{});
+        m_head = (m_head + isFull) % m_capacity;
+        m_tail = (m_tail + 1) % m_capacity;
+        isFull = m_tail == m_head;
+        return 0;
+    }
+
+    /**
+     * @brief pop the oldest record from the buffer.
+     * @return 0 if done, -1 if buffer is empty.
+     */
+    func_result pop_front(Fields&... values) noexcept {
+        if(empty()) return -1;
+        extract(m_head, std::forward_as_tuple(values...), std::index_sequence_for<Fields...>{});
+        m_head = (m_head + 1) % m_capacity;
+        isFull = false;
+        return 0;
+    }
+
+    reference operator[](size_t index) const {
+        return row((m_head + index) % m_capacity, std::index_sequence_for<Fields...>{});
+    }
+
+    template <size_t I>
+    const column_view<std::tuple_element_t<I, value_type>>& column() const {
+        return std::get<I>(m_columns);
+    }
+
+    /**
+     * @brief first contiguous part of the column, starting at the head of the buffer.
+     * @details same as boost::circular_buffer::array_one, but per column.
+     */
+    template <size_t I>
+    array_range<std::tuple_element_t<I, value_type>> array_one() const {
+        auto* data = std::get<I>(m_columns).m_buffer;
+        if(empty()) return {data + m_head, 0};
+        if(m_tail > m_head) return {data + m_head, m_tail - m_head};
+        return {data + m_head, m_capacity - m_head};
+    }
+
+    /**
+     * @brief second contiguous part of the column, empty if the data did not wrap around.
+     */
+    template <size_t I>
+    array_range<std::tuple_element_t<I, value_type>> array_two() const {
+        auto* data = std::get<I>(m_columns).m_buffer;
+        if(empty() || m_tail > m_head) return {data, 0};
+        return {data, m_tail};
+    }
+
+    [[nodiscard]] bool empty() const {
+        return m_head == m_tail && !isFull;
+    }
+
+    [[nodiscard]] size_t size() const {
+        if(isFull) return m_capacity;
+        if(m_tail >= m_head)
+            return m_tail - m_head;
+        return m_capacity - m_head + m_tail;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return m_capacity;
+    }
+
+    bool isSafe() const {
+        return safe;
+    }
+
+    void setSafe(bool safe) {
+        this->safe = safe;
+    }
+
+    void clear() {
+        m_head = m_tail = 0;
+        isFull = false;
+    }
+
+    iterator begin() {
+        return iterator(this, 0);
+    }
+
+    iterator end() {
+        return iterator(this, size());
+    }
+
+private:
+    template <typename Tuple, size_t... I>
+    void assign(size_t position, const Tuple& values, std::index_sequence<I...>) {
+        ((std::get<I>(m_columns).m_buffer[position] = std::get<I>(values)), ...);
+    }
+
+    template <typename Tuple, size_t... I>
+    void extract(size_t position, const Tuple& values, std::index_sequence<I...>) const {
+        ((std::get<I>(values) = std::get<I>(m_columns).m_buffer[position]), ...);
+    }
+
+    template <size_t... I>
+    reference row(size_t position, std::index_sequence<I...>) const {
+        return reference(std::get<I>(m_columns).m_buffer[position]...);
+    }
+
+    template <size_t... I>
+    void copy_columns(const soa_circular_buffer& other, std::index_sequence<I...>) {
+        ((std::get<I>(m_columns).m_buffer = new std::tuple_element_t<I, value_type>[m_capacity]), ...);
+        ((std::copy(std::get<I>(other.m_columns).m_buffer,
+                    std::get<I>(other.m_columns).m_buffer + m_capacity,
+                    std::get<I>(m_columns).m_buffer)), ...);
+    }
+
+    void bind_columns() {
+        std::apply([this](auto&... column) { ((column.m_owner = this), ...); }, m_columns);
+    }
+
+    void steal(soa_circular_buffer& other) {
+        m_columns = other.m_columns;
+        m_capacity = other.m_capacity;
+        m_head = other.m_head;
+        m_tail = other.m_tail;
+        safe = other.safe;
+        isFull = other.isFull;
+        std::apply([](auto&... column) { ((column.m_buffer = nullptr), ...); }, other.m_columns);
+        other.m_capacity = 0;
+        other.m_head = 0;
+        other.m_tail = 0;
+        other.isFull = false;
+        bind_columns();
+    }
+
+    void release() {
+        std::apply([](auto&... column) { ((delete[] column.m_buffer, column.m_buffer = nullptr), ...); }, m_columns);
+    }
+
+private:
+    std::tuple<column_view<Fields>...> m_columns;
+    size_t m_capacity = 0;
+    size_t m_head = 0;
+    size_t m_tail = 0;
+    bool safe = false;
+    bool isFull = false;
+};
+
+}
+
+#endif //SOA_CIRCULAR_BUFFER_H
@@ -1,8 +1,20 @@
 #include <gtest/gtest.h>
 #include <QVector>
 #include <list>
+#include <deque>
+#include <cstring>
 #include "circular_buffer.h"
+#include "soa_circular_buffer.h"
+#include "circular_buffer_device.h"
+#include "record_circular_buffer.h"
+#include "parallel_algorithms.h"
+#include "chunked_queue.h"
+#include "cascading_buffer.h"
+#include "packed_circular_buffer.h"
+#include <QDataStream>
+#include <QCoreApplication>
 #include <random>
+#include <numeric>
 
 TEST(Constructor, DefaultConstructor) {
     veryslot2::circular_buffer<int> buffer(100);
@@ -51,6 +63,62 @@ TEST(Operator, CopyAssignment) {
     buffer2 = buffer2;
 }
 
+TEST(Operator, ImplicitSharing) {
+    veryslot2::circular_buffer<int> buffer(100);
+    for (int i = 0; i < 150; i++) {
+        buffer.push_back(i);
+    }
+    EXPECT_TRUE(buffer.isDetached());
+    veryslot2::circular_buffer<int> snapshot(buffer);
+    veryslot2::circular_buffer<int> assigned(10);
+    assigned = buffer;
+    EXPECT_FALSE(buffer.isDetached());
+    EXPECT_EQ(std::as_const(snapshot).array_one().first, std::as_const(buffer).array_one().first);
+
+    // reading and moving the head do not detach
+    int val;
+    snapshot.pop_front(val);
+    EXPECT_EQ(std::as_const(snapshot)[0], 51);
+    EXPECT_EQ(*snapshot.cbegin(), 51);
+    EXPECT_FALSE(snapshot.isDetached());
+
+    buffer.push_back(1000);
+    EXPECT_TRUE(buffer.isDetached());
+    EXPECT_FALSE(snapshot.isDetached());
+    EXPECT_EQ(buffer[99], 1000);
+    EXPECT_EQ(std::as_const(snapshot)[98], 149);
+    EXPECT_EQ(std::as_const(assigned)[0], 50);
+
+    assigned[0] = -1;
+    EXPECT_TRUE(assigned.isDetached());
+    EXPECT_TRUE(snapshot.isDetached());
+    EXPECT_EQ(std::as_const(snapshot)[0], 51);
+    EXPECT_EQ(assigned[0], -1);
+    EXPECT_EQ(assigned.size(), 100);
+}
+
+struct fragile {
+    static inline bool fail = false;
+    fragile() = default;
+    fragile(const fragile&) = default;
+    fragile& operator=(const fragile&) {
+        if (fail) throw std::runtime_error("copy failed");
+        return *this;
+    }
+    fragile& operator=(fragile&&) = default;
+};
+
+TEST(Operator, DetachThrows) {
+    veryslot2::circular_buffer<fragile> buffer(10);
+    buffer.push_back(fragile());
+    veryslot2::circular_buffer<fragile> snapshot(buffer);
+    fragile::fail = true;
+    EXPECT_THROW(buffer.push_back(fragile()), std::runtime_error);
+    fragile::fail = false;
+    EXPECT_EQ(buffer.size(), 1);
+    EXPECT_FALSE(buffer.isDetached());
+}
+
 TEST(Operator, MoveAssignment) {
     veryslot2::circular_buffer<int> buffer(100);
     for (int i = 0; i < 100; i++) {
@@ -353,3 +421,556 @@ TEST(Methods, BeginEnd) {
 
 }
 
+TEST(SoA, PushPop) {
+    veryslot2::soa_circular_buffer<long, double, int> buffer(100);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_ANY_THROW(veryslot2::soa_circular_buffer<int> buffer2(0));
+    for (int i = 0; i < 150; i++) {
+        buffer.push_back(i, i * 0.5, -i);
+    }
+    EXPECT_EQ(buffer.size(), 100);
+    EXPECT_EQ(std::get<0>(buffer[0]), 50);
+    std::get<2>(buffer[0]) = 7;
+    EXPECT_EQ(buffer.column<2>()[0], 7);
+
+    int i = 50;
+    for (auto row : buffer) {
+        EXPECT_EQ(std::get<0>(row), i);
+        EXPECT_EQ(std::get<1>(row), i * 0.5);
+        i++;
+    }
+
+    long ts;
+    double price;
+    int flags;
+    EXPECT_EQ(buffer.pop_front(ts, price, flags), 0);
+    EXPECT_EQ(ts, 50);
+    EXPECT_EQ(flags, 7);
+    EXPECT_EQ(buffer.size(), 99);
+
+    buffer.clear();
+    buffer.setSafe(true);
+    int counter = 0;
+    while (buffer.push_back(counter, 0, 0) == 0) {
+        ++counter;
+    }
+    EXPECT_EQ(counter, 100);
+    EXPECT_EQ(buffer.pop_front(ts, price, flags), 0);
+    EXPECT_EQ(ts, 0);
+}
+
+TEST(SoA, Columns) {
+    veryslot2::soa_circular_buffer<long, double> buffer(64);
+    auto one = buffer.array_one<1>();
+    EXPECT_EQ(one.second + buffer.array_two<1>().second, 0);
+
+    for (int i = 0; i < 100; i++) {
+        buffer.push_back(i, i);
+    }
+    one = buffer.array_one<1>();
+    auto two = buffer.array_two<1>();
+    EXPECT_EQ(one.second + two.second, buffer.size());
+    double segments = std::accumulate(one.first, one.first + one.second, 0.0);
+    segments = std::accumulate(two.first, two.first + two.second, segments);
+    const auto& prices = buffer.column<1>();
+    EXPECT_EQ(segments, std::accumulate(prices.begin(), prices.end(), 0.0));
+    EXPECT_EQ(*std::max_element(prices.begin(), prices.end()), 99);
+
+    veryslot2::soa_circular_buffer<long, double> copy(buffer);
+    veryslot2::soa_circular_buffer<long, double> moved(std::move(buffer));
+    EXPECT_EQ(buffer.size(), 0);
+    EXPECT_EQ(moved.size(), 64);
+    for (size_t i = 0; i < moved.size(); i++) {
+        EXPECT_EQ(moved.column<0>()[i], copy.column<0>()[i]);
+        EXPECT_EQ(moved.column<0>()[i], i + 36);
+    }
+}
+
+TEST(Methods, ArraysAndErase) {
+    veryslot2::circular_buffer<int> buffer(10);
+    EXPECT_EQ(buffer.array_one().second + buffer.array_two().second, 0);
+    for (int i = 0; i < 15; i++) {
+        buffer.push_back(i);
+    }
+    auto one = buffer.array_one();
+    auto two = buffer.array_two();
+    EXPECT_EQ(one.second + two.second, 10);
+    EXPECT_EQ(*one.first, 5);
+    EXPECT_EQ(*two.first, 10);
+
+    buffer.erase_begin(3);
+    EXPECT_EQ(buffer.size(), 7);
+    EXPECT_EQ(buffer[0], 8);
+    buffer.erase_begin(100);
+    EXPECT_TRUE(buffer.empty());
+
+    veryslot2::circular_buffer<int> fresh(10);
+    std::vector<int> part = {1, 2, 3, 4};
+    EXPECT_EQ(fresh.insert_back(part.begin(), part.end()), 0);
+    EXPECT_EQ(fresh.size(), 4);
+    EXPECT_EQ(fresh.array_one().second, 4);
+}
+
+TEST(Device, ReadWrite) {
+    veryslot2::circular_buffer<char> buffer(16);
+    veryslot2::circular_buffer_device device(&buffer);
+    ASSERT_TRUE(device.open(QIODevice::ReadWrite));
+    EXPECT_TRUE(device.isSequential());
+
+    EXPECT_EQ(device.write("0123456789", 10), 10);
+    EXPECT_EQ(device.bytesAvailable(), 10);
+    char out[32] = {};
+    EXPECT_EQ(device.read(out, 6), 6);
+    EXPECT_EQ(std::string(out, 6), "012345");
+
+    // wraps around the end of the storage
+    EXPECT_EQ(device.write("abcdefghij\n", 11), 11);
+    EXPECT_TRUE(device.canReadLine());
+    EXPECT_EQ(device.read(out, sizeof(out)), 15);
+    EXPECT_EQ(std::string(out, 15), "6789abcdefghij\n");
+    EXPECT_EQ(device.bytesAvailable(), 0);
+
+    buffer.setSafe(true);
+    EXPECT_EQ(device.write("0123456789abcdefXYZ", 19), 16);
+    EXPECT_EQ(device.write("X", 1), 0);
+    EXPECT_EQ(buffer.size(), 16);
+}
+
+TEST(Device, QueuedSignals) {
+    int argc = 0;
+    QCoreApplication app(argc, nullptr);
+    veryslot2::circular_buffer<char> buffer(64);
+    veryslot2::circular_buffer_device device(&buffer);
+    device.open(QIODevice::ReadWrite);
+
+    qint64 written = 0;
+    int readyReads = 0;
+    bool inSlot = false;
+    bool recursed = false;
+    std::string received;
+    QObject::connect(&device, &QIODevice::bytesWritten, [&](qint64 bytes) { written += bytes; });
+    QObject::connect(&device, &QIODevice::readyRead, [&]() {
+        recursed |= inSlot;
+        inSlot = true;
+        ++readyReads;
+        char out[64];
+        qint64 len = device.read(out, sizeof(out));
+        received.append(out, len);
+        // echo a reply back through the same device, once
+        if (readyReads == 1)
+            device.write("pong", 4);
+        inSlot = false;
+    });
+
+    device.write("pi", 2);
+    device.write("ng", 2);
+    // nothing is emitted from inside write()
+    EXPECT_EQ(readyReads, 0);
+    EXPECT_EQ(written, 0);
+
+    QCoreApplication::processEvents();
+    QCoreApplication::processEvents();
+    EXPECT_FALSE(recursed);
+    EXPECT_EQ(readyReads, 2);
+    EXPECT_EQ(written, 8);
+    EXPECT_EQ(received, "pingpong");
+}
+
+TEST(Device, DataStream) {
+    veryslot2::circular_buffer<char> buffer(64);
+    veryslot2::circular_buffer_device device(&buffer);
+    device.open(QIODevice::ReadWrite);
+
+    QDataStream out(&device);
+    out << qint32(42) << QString("hello");
+    QDataStream in(&device);
+    qint32 value;
+    QString text;
+    in >> value >> text;
+    EXPECT_EQ(value, 42);
+    EXPECT_EQ(text, QString("hello"));
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(Records, EmplaceAndRead) {
+    veryslot2::record_circular_buffer buffer(60);
+    EXPECT_EQ(buffer.capacity(), 64);
+    EXPECT_ANY_THROW(veryslot2::record_circular_buffer buffer2(0));
+    EXPECT_EQ(buffer.try_emplace(buffer.max_record_size() + 1).first, nullptr);
+    EXPECT_EQ(buffer.front().first, nullptr);
+    EXPECT_EQ(buffer.pop_front(), -1);
+
+    auto record = buffer.try_emplace(16);
+    ASSERT_NE(record.first, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(record.first) % veryslot2::record_circular_buffer::alignment, 0);
+    std::memcpy(record.first, "hello, world!!!!", 16);
+    EXPECT_EQ(buffer.push_back("0123456789abcdef", 16), 0);
+    EXPECT_EQ(buffer.size(), 2);
+    EXPECT_EQ(buffer.bytes_used(), 48);
+    EXPECT_EQ(std::string(buffer.front().first, buffer.front().second), "hello, world!!!!");
+    EXPECT_EQ(buffer.pop_front(), 0);
+
+    // 16 bytes left at the end, the record goes to the beginning behind a wrap marker
+    EXPECT_EQ(buffer.push_back("0123456789ABCDEF", 16), 0);
+    EXPECT_EQ(buffer.size(), 2);
+    EXPECT_EQ(buffer.bytes_used(), 64);
+    EXPECT_EQ(std::string(buffer.front().first, buffer.front().second), "0123456789abcdef");
+    EXPECT_EQ(buffer.pop_front(), 0);
+    EXPECT_EQ(std::string(buffer.front().first, buffer.front().second), "0123456789ABCDEF");
+    EXPECT_EQ(buffer.bytes_used(), 24);
+
+    // does not fit anywhere, everything is evicted
+    EXPECT_EQ(buffer.push_back("0123456789abcdef0123456789abcdef0123456789abcdef", 48), 0);
+    EXPECT_EQ(buffer.size(), 1);
+    EXPECT_EQ(buffer.front().second, 48);
+
+    buffer.clear();
+    buffer.setSafe(true);
+    EXPECT_EQ(buffer.push_back("a", 1), 0);
+    EXPECT_EQ(buffer.push_back(nullptr, 0), 0);
+    EXPECT_EQ(buffer.push_back("0123456789abcdef0123456789abcdef", 32), 0);
+    EXPECT_EQ(buffer.push_back("b", 1), -1);
+    EXPECT_EQ(buffer.size(), 3);
+    EXPECT_EQ(std::string(buffer.front().first, buffer.front().second), "a");
+}
+
+TEST(Records, EvictionModel) {
+    veryslot2::record_circular_buffer buffer(1000);
+    std::deque<std::string> model;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> length(0, 200);
+    std::uniform_int_distribution<> action(0, 3);
+
+    for (int i = 0; i < 20000; i++) {
+        if (action(gen) == 0) {
+            EXPECT_EQ(buffer.pop_front(), model.empty() ? -1 : 0);
+            if (!model.empty()) model.pop_front();
+        } else {
+            std::string value(length(gen), static_cast<char>('a' + i % 26));
+            ASSERT_EQ(buffer.push_back(value.data(), value.size()), 0);
+            model.push_back(value);
+            while (model.size() > buffer.size()) model.pop_front();
+        }
+        ASSERT_EQ(model.size(), buffer.size());
+        ASSERT_LE(buffer.bytes_used(), buffer.capacity());
+        size_t index = 0;
+        for (auto record : buffer) {
+            ASSERT_EQ(std::string(record.first, record.second), model[index++]);
+        }
+    }
+}
+
+TEST(Methods, Linearize) {
+    veryslot2::circular_buffer<int> buffer(10);
+    for (int i = 0; i < 15; i++) {
+        buffer.push_back(i);
+    }
+    buffer.pop_front(*buffer.at(0));
+    int* data = buffer.linearize();
+    EXPECT_EQ(buffer.array_two().second, 0);
+    EXPECT_EQ(buffer.array_one().second, 9);
+    for (int i = 0; i < 9; i++) {
+        EXPECT_EQ(data[i], i + 6);
+        EXPECT_EQ(buffer[i], i + 6);
+    }
+    buffer.push_back(15);
+    EXPECT_EQ(buffer[9], 15);
+}
+
+TEST(Parallel, Algorithms) {
+    constexpr size_t capacity = 200000;
+    veryslot2::circular_buffer<long> buffer(capacity);
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<long> distrib(-1000000, 1000000);
+    for (size_t i = 0; i < capacity + capacity / 3; i++) {
+        buffer.push_back(distrib(gen));
+    }
+    long dropped;
+    for (int i = 0; i < 1000; i++) {
+        buffer.pop_front(dropped);
+    }
+    std::vector<long> expected(buffer.begin(), buffer.end());
+
+    EXPECT_EQ(veryslot2::parallel::reduce(buffer, 0L, std::plus<long>(), 4),
+              std::accumulate(expected.begin(), expected.end(), 0L));
+
+    std::vector<long> doubled(buffer.size());
+    veryslot2::parallel::transform(buffer, doubled.begin(), [](long v) { return v * 2; }, 4);
+    veryslot2::parallel::transform(buffer, [](long v) { return v * 2; }, 4);
+    long counted = 0;
+    veryslot2::parallel::for_each(buffer, [](long& v) { v /= 2; }, 4);
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(doubled[i], expected[i] * 2);
+        counted += buffer[i] == expected[i];
+    }
+    EXPECT_EQ(counted, expected.size());
+
+    long needle = expected[expected.size() - 10];
+    auto found = veryslot2::parallel::find(buffer, needle, 4);
+    EXPECT_EQ(found - buffer.begin(), std::find(expected.begin(), expected.end(), needle) - expected.begin());
+    EXPECT_TRUE(veryslot2::parallel::find(buffer, 5000000L, 4) == buffer.end());
+
+    veryslot2::parallel::sort(buffer, std::greater<long>(), 3);
+    std::sort(expected.begin(), expected.end(), std::greater<long>());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin()));
+
+    veryslot2::circular_buffer<int> small(10);
+    EXPECT_EQ(veryslot2::parallel::reduce(small, 5), 5);
+    small.push_back(3);
+    small.push_back(1);
+    veryslot2::parallel::sort(small);
+    EXPECT_EQ(small[0], 1);
+}
+
+TEST(ChunkedQueue, PushPop) {
+    EXPECT_ANY_THROW(veryslot2::chunked_queue<int> queue2(0));
+    veryslot2::chunked_queue<int> queue(16, 2);
+    int val;
+    EXPECT_EQ(queue.pop_front(val), -1);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(queue.push_back(i), 0);
+    }
+    EXPECT_EQ(queue.size(), 100);
+    EXPECT_EQ(queue.chunks(), 7);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(queue.pop_front(val), 0);
+        EXPECT_EQ(val, i);
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.chunks(), 0);
+    EXPECT_EQ(queue.pooled(), 2);
+
+    queue.emplace_back(5);
+    EXPECT_EQ(queue.pooled(), 1);
+    queue.clear();
+    EXPECT_TRUE(queue.empty());
+    queue.shrink_to_fit();
+    EXPECT_EQ(queue.pooled(), 0);
+}
+
+TEST(ChunkedQueue, InsertBack) {
+    veryslot2::chunked_queue<int> queue(10);
+    std::vector<int> test(95);
+    std::iota(test.begin(), test.end(), 0);
+    std::list<int> test2(test.begin(), test.end());
+
+    queue.push_back(-1);
+    int val;
+    queue.pop_front(val);
+    queue.push_back(-1);
+    EXPECT_EQ(queue.insert_back(test.begin(), test.end()), 0);
+    EXPECT_EQ(queue.insert_back(test2.begin(), test2.end()), 0);
+    EXPECT_EQ(queue.size(), 191);
+
+    queue.pop_front(val);
+    EXPECT_EQ(val, -1);
+    for (int i = 0; i < 190; i++) {
+        EXPECT_EQ(queue.pop_front(val), 0);
+        EXPECT_EQ(val, i % 95);
+    }
+    EXPECT_EQ(queue.pop_front(val), -1);
+
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<> distrib(0, 30);
+    std::deque<int> model;
+    int counter = 0;
+    for (int i = 0; i < 2000; i++) {
+        std::vector<int> part(distrib(gen));
+        for (auto& v : part) v = counter++;
+        queue.insert_back(part.begin(), part.end());
+        model.insert(model.end(), part.begin(), part.end());
+        for (int j = distrib(gen); j > 0 && !model.empty(); --j) {
+            ASSERT_EQ(queue.pop_front(val), 0);
+            ASSERT_EQ(val, model.front());
+            model.pop_front();
+        }
+        ASSERT_EQ(queue.size(), model.size());
+    }
+}
+
+TEST(Cascading, RollUp) {
+    using history = veryslot2::cascading_buffer<double>;
+    EXPECT_ANY_THROW(history({}, veryslot2::aggregate::avg));
+    EXPECT_ANY_THROW(history({{10, 2}}, veryslot2::aggregate::avg));
+    EXPECT_ANY_THROW(history({{10, 1}, {10, 7}, {10, 10}}, veryslot2::aggregate::avg));
+
+    history avg({{120, 1}, {60, 60}, {24, 3600}}, veryslot2::aggregate::avg);
+    history max({{120, 1}, {60, 60}, {24, 3600}}, veryslot2::aggregate::max);
+    history sum({{120, 1}, {60, 60}, {24, 3600}}, veryslot2::aggregate::sum);
+    history last({{120, 1}, {60, 60}, {24, 3600}}, veryslot2::aggregate::last);
+    for (int i = 0; i < 3 * 3600 + 30; i++) {
+        avg.push_back(i);
+        max.push_back(i % 100);
+        sum.push_back(1);
+        last.push_back(i);
+    }
+    EXPECT_EQ(avg.tier_buffer(0).size(), 120);
+    EXPECT_EQ(avg.tier_buffer(1).size(), 60);
+    EXPECT_EQ(avg.tier_buffer(2).size(), 3);
+    EXPECT_EQ(avg.step(2), 3600);
+
+    EXPECT_EQ(avg.tier_buffer(2)[0], 1799.5);
+    EXPECT_EQ(avg.tier_buffer(2)[2], 2 * 3600 + 1799.5);
+    EXPECT_EQ(avg.tier_buffer(1)[59], 3 * 3600 - 60 + 29.5);
+    EXPECT_EQ(max.tier_buffer(1)[59], 99);
+    EXPECT_EQ(sum.tier_buffer(1)[0], 60);
+    EXPECT_EQ(sum.tier_buffer(2)[1], 3600);
+    EXPECT_EQ(last.tier_buffer(2)[0], 3599);
+
+    EXPECT_EQ(avg.tier_for(100), 0);
+    EXPECT_EQ(avg.tier_for(121), 1);
+    EXPECT_EQ(avg.tier_for(120, 10), 1);
+    EXPECT_EQ(avg.tier_for(3 * 3600), 2);
+    EXPECT_EQ(avg.tier_for(1000 * 3600), 2);
+
+    auto values = avg.last(10);
+    ASSERT_EQ(values.size(), 10);
+    EXPECT_EQ(values.back(), 3 * 3600 + 29);
+    values = avg.last(600);
+    ASSERT_EQ(values.size(), 10);
+    EXPECT_EQ(values.back(), 3 * 3600 - 60 + 29.5);
+    EXPECT_EQ(avg.last(1000 * 3600).size(), 3);
+
+    avg.clear();
+    EXPECT_TRUE(avg.tier_buffer(2).empty());
+    EXPECT_TRUE(avg.last(10).empty());
+
+    // integral avg is truncated once per bucket, not once per tier
+    veryslot2::cascading_buffer<int> integral({{8, 1}, {8, 2}, {8, 4}}, veryslot2::aggregate::avg);
+    for (int sample : {0, 1, 1, 2, -3, -4, -4, -4}) {
+        integral.push_back(sample);
+    }
+    EXPECT_EQ(integral.tier_buffer(1)[0], 0);
+    EXPECT_EQ(integral.tier_buffer(1)[1], 1);
+    EXPECT_EQ(integral.tier_buffer(2)[0], 1);
+    EXPECT_EQ(integral.tier_buffer(2)[1], -3);
+}
+
+TEST(Packed, Bits) {
+    EXPECT_ANY_THROW(veryslot2::bit_circular_buffer buffer2(0));
+    veryslot2::bit_circular_buffer buffer(100);
+    EXPECT_EQ(buffer.storage_bytes(), 16);
+    for (int i = 0; i < 130; i++) {
+        buffer.push_back(i % 3 == 0);
+    }
+    EXPECT_EQ(buffer.size(), 100);
+    EXPECT_EQ(buffer.count(true), std::count_if(buffer.cbegin(), buffer.cend(), [](bool b) { return b; }));
+    EXPECT_EQ(buffer.count(true, 10, 30), 10);
+    EXPECT_EQ(buffer.count(false, 95, 30), 3);
+
+    buffer[0] = true;
+    buffer[1] = buffer[0];
+    EXPECT_TRUE(buffer[1]);
+    std::fill(buffer.begin(), buffer.end(), false);
+    EXPECT_EQ(buffer.count(true), 0);
+    std::reverse(buffer.begin(), buffer.end());
+
+    bool val;
+    buffer.clear();
+    buffer.setSafe(true);
+    int counter = 0;
+    while (buffer.push_back(true) == 0) {
+        ++counter;
+    }
+    EXPECT_EQ(counter, 100);
+    EXPECT_EQ(buffer.pop_front(val), 0);
+    EXPECT_TRUE(val);
+    std::vector<bool> more(5, false);
+    EXPECT_EQ(buffer.insert_back(more.begin(), more.end()), 4);
+    EXPECT_EQ(buffer.count(false), 1);
+}
+
+TEST(Packed, Wide) {
+    static_assert(std::is_same_v<veryslot2::packed_circular_buffer<16>::value_type, uint16_t>);
+    static_assert(std::is_same_v<veryslot2::packed_circular_buffer<32>::value_type, uint32_t>);
+    veryslot2::packed_circular_buffer<16> buffer16(5);
+    for (uint16_t i = 0; i < 7; i++) {
+        buffer16.push_back(1000 + i * 10000);
+    }
+    EXPECT_EQ(buffer16.size(), 5);
+    EXPECT_EQ(buffer16[0], 21000);
+    EXPECT_EQ(buffer16[4], 61000);
+    EXPECT_EQ(buffer16.count(41000), 1);
+    uint16_t val16;
+    EXPECT_EQ(buffer16.pop_front(val16), 0);
+    EXPECT_EQ(val16, 21000);
+
+    veryslot2::packed_circular_buffer<32> buffer32(3);
+    std::vector<uint32_t> test = {70000, 0xFFFFFFFF, 123456789, 65536};
+    EXPECT_EQ(buffer32.insert_back(test.begin(), test.end()), 1);
+    EXPECT_TRUE(std::equal(test.begin() + 1, test.end(), buffer32.cbegin()));
+    EXPECT_EQ(buffer32.count(0xFFFFFFFF), 1);
+    uint32_t val32;
+    EXPECT_EQ(buffer32.pop_front(val32), 0);
+    EXPECT_EQ(val32, 0xFFFFFFFF);
+}
+
+TEST(Packed, ModelCheck) {
+    veryslot2::packed_circular_buffer<4> buffer(77);
+    std::deque<uint8_t> model;
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> value(0, 15);
+    std::uniform_int_distribution<> action(0, 4);
+    std::uniform_int_distribution<> length(0, 200);
+
+    for (int i = 0; i < 3000; i++) {
+        switch (action(gen)) {
+            case 0: {
+                uint8_t val;
+                EXPECT_EQ(buffer.pop_front(val), model.empty() ? -1 : 0);
+                if (!model.empty()) {
+                    EXPECT_EQ(val, model.front());
+                    model.pop_front();
+                }
+                break;
+            }
+            case 1: {
+                size_t n = length(gen) % 20;
+                buffer.erase_begin(n);
+                model.erase(model.begin(), model.begin() + std::min(n, model.size()));
+                break;
+            }
+            case 2: {
+                // values packed in the same layout, appended a word at a time
+                size_t n = length(gen);
+                std::vector<uint64_t> words(n / 16 + 1, 0);
+                std::vector<uint8_t> values(n);
+                for (size_t j = 0; j < n; j++) {
+                    values[j] = value(gen);
+                    words[j / 16] |= uint64_t(values[j]) << (j % 16 * 4);
+                }
+                size_t from = n ? n / 3 : 0;
+                EXPECT_EQ(buffer.insert_words(words.data(), n - from, from), n - from > 77 ? n - from - 77 : 0);
+                model.insert(model.end(), values.begin() + from, values.end());
+                while (model.size() > 77) model.pop_front();
+                break;
+            }
+            default: {
+                uint8_t val = value(gen);
+                EXPECT_EQ(buffer.push_back(val), 0);
+                model.push_back(val);
+                while (model.size() > 77) model.pop_front();
+            }
+        }
+        ASSERT_EQ(buffer.size(), model.size());
+        ASSERT_TRUE(std::equal(model.begin(), model.end(), buffer.cbegin()));
+
+        size_t first = length(gen) % 80;
+        size_t n = length(gen) % 80;
+        uint8_t needle = value(gen);
+        size_t expected = 0;
+        for (size_t j = first; j < std::min(model.size(), first + n); j++) {
+            expected += model[j] == needle;
+        }
+        ASSERT_EQ(buffer.count(needle, first, n), expected);
+
+        if (first < model.size()) {
+            n = std::min(n, model.size() - first);
+            std::vector<uint64_t> out(n / 16 + 1, 0);
+            buffer.extract_words(first, n, out.data());
+            for (size_t j = 0; j < n; j++) {
+                ASSERT_EQ((out[j / 16] >> (j % 16 * 4)) & 15, model[first + j]);
+            }
+        }
+    }
+}